@@ -1,8 +1,15 @@
 #version 300 es
 
+#ifdef SPRITE_INSTANCING
+// one record per sprite, the corners are derived from it (see SpriteBatcher::Instance)
+layout(location=0) in vec2 origin;
+layout(location=1) in vec4 textureRect;
+layout(location=5) in vec4 edges;
+#else
 layout(location=0) in vec2 position;
 layout(location=1) in vec2 texcoord;
-layout(location=2) in vec4 color;
+#endif
+layout(location=2) in mediump vec4 color;
 
 uniform mat4 modelViewProjection;
 
@@ -11,6 +18,12 @@ out vec4 vs_color;
 
 void main(void)
 {
+#ifdef SPRITE_INSTANCING
+    // drawn as a 4 vertex triangle strip: corners 0, 1, 3, 2
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 position = origin + corner.x * edges.xy + corner.y * edges.zw;
+    vec2 texcoord = mix(textureRect.xy, textureRect.zw, corner);
+#endif
     vs_texcoord = texcoord;
     vs_color = color;
     gl_Position = modelViewProjection * vec4(position, 0, 1);
@@ -0,0 +1,51 @@
+#include "autosaver.h"
+
+Autosaver::Autosaver(const std::string &path)
+    : m_path(path)
+{
+#ifndef __EMSCRIPTEN__
+    m_thread = std::thread(&Autosaver::run, this);
+#endif
+}
+
+Autosaver::~Autosaver()
+{
+#ifndef __EMSCRIPTEN__
+    {
+        std::lock_guard lock(m_mutex);
+        m_done = true;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+#endif
+}
+
+void Autosaver::save(SaveGame saveGame)
+{
+#ifndef __EMSCRIPTEN__
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending = std::move(saveGame);
+    }
+    m_condition.notify_one();
+#else
+    saveGame.save(m_path);
+#endif
+}
+
+void Autosaver::run()
+{
+#ifndef __EMSCRIPTEN__
+    for (;;) {
+        std::optional<SaveGame> saveGame;
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_pending || m_done; });
+            if (!m_pending)
+                return;
+            saveGame.swap(m_pending);
+        }
+        saveGame->save(m_path);
+    }
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "savegame.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Writes save games on a background thread so that the render loop never
+// waits for the disk. Only the latest request matters: a newer snapshot
+// replaces one that hasn't been written yet. Without threads (emscripten)
+// saves happen synchronously.
+class Autosaver
+{
+public:
+    explicit Autosaver(const std::string &path);
+    ~Autosaver(); // finishes writing whatever is still pending
+
+    Autosaver(const Autosaver &) = delete;
+    Autosaver &operator=(const Autosaver &) = delete;
+
+    void save(SaveGame saveGame);
+
+private:
+    void run();
+
+    std::string m_path;
+#ifndef __EMSCRIPTEN__
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::optional<SaveGame> m_pending;
+    bool m_done = false;
+    std::thread m_thread;
+#endif
+};
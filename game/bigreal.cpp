@@ -0,0 +1,93 @@
+#include "bigreal.h"
+
+#include <algorithm>
+
+namespace {
+constexpr auto UpScale = 0x1p512;
+constexpr auto DownScale = 0x1p-512;
+} // namespace
+
+std::pair<double, int64_t> BigReal::toDecimal() const
+{
+    if (m_mantissa == 0.0)
+        return { 0.0, 0 };
+    constexpr auto Log10Step = ExponentStep * 0.30102999566398119521;
+    const auto log = std::log10(std::abs(m_mantissa)) + Log10Step * m_exponent;
+    auto exponent = static_cast<int64_t>(std::floor(log));
+    auto mantissa = std::pow(10.0, log - exponent);
+    if (mantissa >= 10.0) {
+        mantissa /= 10.0;
+        ++exponent;
+    }
+    return { std::copysign(mantissa, m_mantissa), exponent };
+}
+
+BigReal BigReal::normalized(double mantissa, int32_t exponent)
+{
+    if (!std::isfinite(mantissa))
+        return BigReal(mantissa, exponent);
+    if (mantissa == 0.0)
+        return BigReal();
+    while (std::abs(mantissa) >= MaxMantissa) {
+        mantissa *= DownScale;
+        ++exponent;
+    }
+    while (std::abs(mantissa) < MinMantissa) {
+        mantissa *= UpScale;
+        --exponent;
+    }
+    return BigReal(mantissa, exponent);
+}
+
+double BigReal::scaledToDouble(const BigReal &value)
+{
+    // clamp so that ldexp saturates to inf/0 instead of overflowing the int
+    constexpr auto MaxExponent = 8;
+    const auto exponent = std::clamp(value.m_exponent, -MaxExponent, MaxExponent);
+    return std::ldexp(value.m_mantissa, ExponentStep * exponent);
+}
+
+BigReal BigReal::add(const BigReal &lhs, const BigReal &rhs)
+{
+    const auto a = normalized(lhs);
+    const auto b = normalized(rhs);
+    if (a.m_mantissa == 0.0)
+        return b;
+    if (b.m_mantissa == 0.0)
+        return a;
+    // anything more than one step apart is below the precision of the mantissa
+    switch (a.m_exponent - b.m_exponent) {
+    case 0:
+        return normalized(a.m_mantissa + b.m_mantissa, a.m_exponent);
+    case 1:
+        return normalized(a.m_mantissa + b.m_mantissa * DownScale, a.m_exponent);
+    case -1:
+        return normalized(a.m_mantissa * DownScale + b.m_mantissa, b.m_exponent);
+    default:
+        return a.m_exponent > b.m_exponent ? a : b;
+    }
+}
+
+BigReal BigReal::multiply(const BigReal &lhs, const BigReal &rhs)
+{
+    const auto a = normalized(lhs);
+    const auto b = normalized(rhs);
+    return normalized(a.m_mantissa * b.m_mantissa, a.m_exponent + b.m_exponent);
+}
+
+BigReal BigReal::divide(const BigReal &lhs, const BigReal &rhs)
+{
+    const auto a = normalized(lhs);
+    const auto b = normalized(rhs);
+    return normalized(a.m_mantissa / b.m_mantissa, a.m_exponent - b.m_exponent);
+}
+
+int BigReal::compare(const BigReal &lhs, const BigReal &rhs)
+{
+    const auto a = normalized(lhs);
+    const auto b = normalized(rhs);
+    if (a.m_exponent == b.m_exponent || a.m_mantissa == 0.0 || b.m_mantissa == 0.0 || (a.m_mantissa < 0.0) != (b.m_mantissa < 0.0))
+        return a.m_mantissa < b.m_mantissa ? -1 : (b.m_mantissa < a.m_mantissa ? 1 : 0);
+    const auto less = a.m_mantissa < 0.0 ? a.m_exponent > b.m_exponent : a.m_exponent < b.m_exponent;
+    return less ? -1 : 1;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Number with a double mantissa and a wide exponent, for resource amounts
+// that outgrow double.
+//
+// The value is mantissa * 2^(ExponentStep * exponent). Values below 2^256
+// (~1e77) keep a zero exponent, so arithmetic on them is plain double
+// arithmetic plus one range check. Everything else (operands with non-zero
+// exponents, results leaving the range) goes through the out-of-line slow
+// paths in bigreal.cpp, which keeps the inlined code small.
+class BigReal
+{
+public:
+    constexpr BigReal() = default;
+    BigReal(double value)
+        : m_mantissa(value)
+    {
+        if (!inRange(value))
+            *this = normalized(value, 0);
+    }
+
+    template<typename T, typename = std::enable_if_t<std::is_floating_point_v<T>>>
+    explicit operator T() const
+    {
+        return static_cast<T>(toDouble());
+    }
+
+    // Saturates to +-inf or 0 outside the range of double.
+    double toDouble() const
+    {
+        return m_exponent == 0 ? m_mantissa : scaledToDouble(*this);
+    }
+
+    // Splits into a mantissa in [1, 10) and a power of ten.
+    std::pair<double, int64_t> toDecimal() const;
+
+    // Raw representation, for serialization.
+    double mantissa() const { return m_mantissa; }
+    int32_t exponent() const { return m_exponent; }
+    static BigReal fromParts(double mantissa, int32_t exponent) { return normalized(mantissa, exponent); }
+
+    BigReal operator-() const { return BigReal(-m_mantissa, m_exponent); }
+
+    BigReal &operator+=(const BigReal &other) { return *this = *this + other; }
+    BigReal &operator-=(const BigReal &other) { return *this = *this - other; }
+    BigReal &operator*=(const BigReal &other) { return *this = *this * other; }
+    BigReal &operator/=(const BigReal &other) { return *this = *this / other; }
+
+    friend BigReal operator+(const BigReal &lhs, const BigReal &rhs)
+    {
+        const auto sum = lhs.m_mantissa + rhs.m_mantissa;
+        if (((lhs.m_exponent | rhs.m_exponent) == 0) & inRange(sum))
+            return BigReal(sum, 0);
+        return add(lhs, rhs);
+    }
+
+    friend BigReal operator-(const BigReal &lhs, const BigReal &rhs)
+    {
+        return lhs + -rhs;
+    }
+
+    friend BigReal operator*(const BigReal &lhs, const BigReal &rhs)
+    {
+        const auto product = lhs.m_mantissa * rhs.m_mantissa;
+        if (((lhs.m_exponent | rhs.m_exponent) == 0) & inRange(product))
+            return BigReal(product, 0);
+        return multiply(lhs, rhs);
+    }
+
+    friend BigReal operator/(const BigReal &lhs, const BigReal &rhs)
+    {
+        const auto quotient = lhs.m_mantissa / rhs.m_mantissa;
+        if (((lhs.m_exponent | rhs.m_exponent) == 0) & inRange(quotient) & (std::abs(rhs.m_mantissa) >= MinMantissa))
+            return BigReal(quotient, 0);
+        return divide(lhs, rhs);
+    }
+
+    friend bool operator==(const BigReal &lhs, const BigReal &rhs)
+    {
+        if (lhs.m_exponent == rhs.m_exponent)
+            return lhs.m_mantissa == rhs.m_mantissa;
+        return compare(lhs, rhs) == 0;
+    }
+
+    friend bool operator!=(const BigReal &lhs, const BigReal &rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    friend bool operator<(const BigReal &lhs, const BigReal &rhs)
+    {
+        if (lhs.m_exponent == rhs.m_exponent)
+            return lhs.m_mantissa < rhs.m_mantissa;
+        return compare(lhs, rhs) < 0;
+    }
+
+    friend bool operator>(const BigReal &lhs, const BigReal &rhs) { return rhs < lhs; }
+    friend bool operator<=(const BigReal &lhs, const BigReal &rhs) { return !(rhs < lhs); }
+    friend bool operator>=(const BigReal &lhs, const BigReal &rhs) { return !(lhs < rhs); }
+
+private:
+    static constexpr auto ExponentStep = 512;
+    static constexpr auto MaxMantissa = 0x1p256;
+    static constexpr auto MinMantissa = 0x1p-256;
+
+    constexpr BigReal(double mantissa, int32_t exponent)
+        : m_mantissa(mantissa)
+        , m_exponent(exponent)
+    {
+    }
+
+    static bool inRange(double mantissa)
+    {
+        return std::abs(mantissa) < MaxMantissa;
+    }
+
+    // Brings the mantissa into [2^-256, 2^256), zero gets a zero exponent.
+    static BigReal normalized(double mantissa, int32_t exponent);
+    static BigReal normalized(const BigReal &value) { return normalized(value.m_mantissa, value.m_exponent); }
+
+    static double scaledToDouble(const BigReal &value);
+    static BigReal add(const BigReal &lhs, const BigReal &rhs);
+    static BigReal multiply(const BigReal &lhs, const BigReal &rhs);
+    static BigReal divide(const BigReal &lhs, const BigReal &rhs);
+    static int compare(const BigReal &lhs, const BigReal &rhs);
+
+    double m_mantissa = 0.0;
+    int32_t m_exponent = 0;
+};
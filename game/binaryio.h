@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size fields for the save game and input recording files. Files are
+// little-endian; numbers are swapped on big-endian hosts, on the way in and
+// on the way out alike, so files move between machines.
+
+namespace Detail {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool BigEndianHost = true;
+#else
+constexpr bool BigEndianHost = false;
+#endif
+
+template<typename T>
+void swapToFileOrder(char *bytes)
+{
+    if constexpr (BigEndianHost && std::is_arithmetic_v<T>)
+        std::reverse(bytes, bytes + sizeof(T));
+}
+
+} // namespace Detail
+
+class BinaryWriter
+{
+public:
+    template<typename T>
+    void write(const T &value)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        Detail::swapToFileOrder<T>(bytes);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void writeBytes(const char *data, std::size_t size) { m_buffer.insert(m_buffer.end(), data, data + size); }
+
+    const std::vector<char> &buffer() const { return m_buffer; }
+    void clear() { m_buffer.clear(); }
+
+private:
+    std::vector<char> m_buffer;
+};
+
+class BinaryReader
+{
+public:
+    BinaryReader() = default;
+    BinaryReader(const char *data, std::size_t size)
+        : m_data(data)
+        , m_end(data + size)
+    {
+    }
+
+    template<typename T>
+    bool read(T &value)
+    {
+        if (remaining() < sizeof(T))
+            return false;
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, m_data, sizeof(T));
+        Detail::swapToFileOrder<T>(bytes);
+        std::memcpy(&value, bytes, sizeof(T));
+        m_data += sizeof(T);
+        return true;
+    }
+
+    bool skip(std::size_t size)
+    {
+        if (remaining() < size)
+            return false;
+        m_data += size;
+        return true;
+    }
+
+    const char *position() const { return m_data; }
+    std::size_t remaining() const { return m_end - m_data; }
+
+private:
+    const char *m_data = nullptr;
+    const char *m_end = nullptr;
+};
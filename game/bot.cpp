@@ -0,0 +1,148 @@
+#include "bot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+constexpr auto Never = std::numeric_limits<double>::infinity();
+
+// World harvests 5 to 8 Wh per click.
+constexpr auto MinHarvest = 5;
+constexpr auto MaxHarvest = 8;
+
+// Production the unit would add, relative to the current production of each
+// resource so that extropy, energy and material weigh the same. Carbon is
+// only emitted, it doesn't count.
+double relativeGain(const Simulation &simulation, const Unit *unit)
+{
+    StateVector gain;
+    switch (unit->type) {
+    case Unit::Type::Generator:
+        gain = simulation.boostMultiplier(unit) * unit->yield;
+        break;
+    case Unit::Type::Booster:
+        gain = simulation.boostGain(unit);
+        break;
+    }
+    const auto delta = simulation.stateDelta();
+    const auto relative = [](Real gain, Real production) {
+        return static_cast<double>(gain / std::max(production, Real(1.0)));
+    };
+    return relative(gain.extropy, delta.extropy) + relative(gain.energy, delta.energy) + relative(gain.material, delta.material);
+}
+
+// Harvests by hand until some unit can be paid for. Only meaningful before
+// anything produces energy, which is also when the game suggests doing it.
+bool harvest(Simulation &simulation, const PlayerModel &player, std::mt19937 &generator, Playthrough &playthrough)
+{
+    const auto state = simulation.state();
+    double shortfall = Never;
+    for (const auto &unit : simulation.techGraph()->units) {
+        if (!simulation.isUnlocked(unit.get()))
+            continue;
+        const auto cost = simulation.cost(unit.get());
+        if (cost.extropy > state.extropy || cost.material > state.material)
+            continue; // clicking doesn't help
+        shortfall = std::min(shortfall, static_cast<double>(cost.energy - state.energy));
+    }
+    if (shortfall == Never)
+        return false;
+
+    int clicks = 0;
+    double harvested = 0.0;
+    if (player.randomHarvest) {
+        std::uniform_int_distribution<int> harvest(MinHarvest, MaxHarvest);
+        do {
+            harvested += harvest(generator);
+            ++clicks;
+        } while (harvested < shortfall);
+    } else {
+        constexpr auto AverageHarvest = 0.5 * (MinHarvest + MaxHarvest);
+        clicks = static_cast<int>(std::max(std::ceil(shortfall / AverageHarvest), 1.0));
+        harvested = clicks * AverageHarvest;
+    }
+    const auto seconds = clicks / player.clicksPerSecond;
+    simulation.fastForward(seconds);
+    simulation.addEnergy(harvested);
+    playthrough.clickTime += seconds;
+    playthrough.time += seconds;
+    return true;
+}
+} // namespace
+
+const Unit *CheapestFirst::choose(const Simulation &simulation) const
+{
+    const Unit *best = nullptr;
+    auto bestTime = Never;
+    for (const auto &unit : simulation.techGraph()->units) {
+        const auto time = simulation.timeUntilAcquirable(unit.get());
+        if (time < bestTime) {
+            best = unit.get();
+            bestTime = time;
+        }
+    }
+    return best;
+}
+
+const Unit *BestYieldPerCost::choose(const Simulation &simulation) const
+{
+    // the extra second keeps units that are affordable right now comparable
+    const Unit *best = nullptr;
+    double bestScore = 0.0;
+    for (const auto &unit : simulation.techGraph()->units) {
+        const auto time = simulation.timeUntilAcquirable(unit.get());
+        if (time == Never)
+            continue;
+        const auto score = relativeGain(simulation, unit.get()) / (time + 1.0);
+        if (score > bestScore) {
+            best = unit.get();
+            bestScore = score;
+        }
+    }
+    if (!best)
+        return CheapestFirst().choose(simulation); // nothing produces more, just unlock something
+    return best;
+}
+
+double Playthrough::milestone(int index)
+{
+    return std::pow(1e3, index + 1);
+}
+
+Playthrough play(const TechGraph &techGraph, const Strategy &strategy, const PlayerModel &player, uint32_t seed, double goal, double timeLimit)
+{
+    std::mt19937 generator(seed);
+    std::exponential_distribution<double> reactionTime(player.reactionTime > 0.0 ? 1.0 / player.reactionTime : 1.0);
+
+    Simulation simulation(&techGraph);
+    Playthrough playthrough;
+    playthrough.milestoneTimes.fill(Never);
+    int nextMilestone = 0;
+    while (simulation.stateDelta().energy < Real(goal) && playthrough.time < timeLimit) {
+        const auto *unit = strategy.choose(simulation);
+        auto wait = unit ? simulation.timeUntilAcquirable(unit) : Never;
+        if (wait == Never || (wait > 0.0 && simulation.stateDelta().energy == Real(0.0))) {
+            if (!harvest(simulation, player, generator, playthrough))
+                break; // stuck
+            continue;
+        }
+        if (player.reactionTime > 0.0)
+            wait += reactionTime(generator);
+        if (playthrough.time + wait > timeLimit) {
+            playthrough.time = timeLimit;
+            break;
+        }
+        simulation.fastForward(wait);
+        playthrough.time += wait;
+        if (!simulation.acquire(unit))
+            break; // can't happen, the wait covers the cost
+        const auto production = simulation.stateDelta().energy;
+        playthrough.purchases.push_back({ playthrough.time, unit, simulation.count(unit), production });
+        // production only changes on purchases, so this is exactly when it got there
+        while (nextMilestone < Playthrough::MilestoneCount && production >= Real(Playthrough::milestone(nextMilestone)))
+            playthrough.milestoneTimes[nextMilestone++] = playthrough.time;
+    }
+    playthrough.reachedGoal = simulation.stateDelta().energy >= Real(goal);
+    return playthrough;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "simulation.h"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Automated player for testing tech graphs: plays with the real Simulation
+// rules, but instead of stepping frames it jumps straight to the moment the
+// next unit it wants becomes affordable, so hours of play take milliseconds.
+
+class Strategy
+{
+public:
+    virtual ~Strategy() = default;
+
+    virtual std::string name() const = 0;
+    // The unit to save up for next, or nullptr if nothing is worth waiting for.
+    virtual const Unit *choose(const Simulation &simulation) const = 0;
+};
+
+// Buys whatever becomes affordable first.
+class CheapestFirst : public Strategy
+{
+public:
+    std::string name() const override { return "cheapest"; }
+    const Unit *choose(const Simulation &simulation) const override;
+};
+
+// Buys the unit with the largest production gain per second of waiting for
+// it, boosters included.
+class BestYieldPerCost : public Strategy
+{
+public:
+    std::string name() const override { return "yield"; }
+    const Unit *choose(const Simulation &simulation) const override;
+};
+
+// How the bot plays apart from its choices. The defaults play perfectly.
+struct PlayerModel {
+    double clicksPerSecond = 4.0; // harvesting by hand before anything produces energy
+    bool randomHarvest = false; // roll each click like World does instead of taking the average
+    double reactionTime = 0.0; // mean of the exponentially distributed delay before each purchase
+};
+
+struct Purchase {
+    double time;
+    const Unit *unit;
+    int count;
+    Real energyProduction;
+};
+
+struct Playthrough {
+    // energy production of 1 kWh/s, 1 MWh/s, ... 1 ZWh/s
+    static constexpr auto MilestoneCount = 7;
+    static double milestone(int index);
+
+    std::vector<Purchase> purchases;
+    std::array<double, MilestoneCount> milestoneTimes; // infinity if never reached
+    double clickTime = 0.0; // time spent harvesting by hand
+    double time = 0.0;
+    bool reachedGoal = false;
+};
+
+// Energy production the game shows as 1 ZWh/s.
+constexpr auto Zettawatt = 1e21;
+
+Playthrough play(const TechGraph &techGraph, const Strategy &strategy, const PlayerModel &player, uint32_t seed,
+                 double goal = Zettawatt, double timeLimit = std::numeric_limits<double>::infinity());
@@ -0,0 +1,28 @@
+#include "fixedtimestep.h"
+
+#include <cmath>
+
+FixedTimestep::FixedTimestep(double tickRate)
+    : m_tickRate(tickRate)
+    , m_interval(static_cast<std::chrono::nanoseconds::rep>(std::round(1e9 / tickRate)))
+    , m_tickInterval(std::chrono::duration<double>(m_interval).count())
+{
+}
+
+int FixedTimestep::advance(std::chrono::nanoseconds elapsed)
+{
+    m_lag += elapsed;
+    const auto ticks = m_lag / m_interval;
+    m_lag -= ticks * m_interval;
+    return static_cast<int>(ticks);
+}
+
+int FixedTimestep::advance(double elapsed)
+{
+    return advance(std::chrono::round<std::chrono::nanoseconds>(std::chrono::duration<double>(elapsed)));
+}
+
+double FixedTimestep::lag() const
+{
+    return std::chrono::duration<double>(m_lag).count();
+}
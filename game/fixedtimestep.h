@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+
+// Turns variable frame times into a whole number of fixed-length simulation
+// ticks. Time is accumulated in integer nanoseconds and every tick advances
+// the simulation by exactly the same interval, so the simulation ends up in
+// the same state no matter how the frames split the time.
+class FixedTimestep
+{
+public:
+    explicit FixedTimestep(double tickRate);
+
+    // Adds frame time, returns how many ticks are due.
+    int advance(std::chrono::nanoseconds elapsed);
+    int advance(double elapsed);
+
+    double tickRate() const { return m_tickRate; }
+    double tickInterval() const { return m_tickInterval; }
+
+    // Time since the last tick in seconds, always below one tick interval.
+    // Renderers add this to the simulated state to stay smooth between ticks.
+    double lag() const;
+
+private:
+    double m_tickRate;
+    std::chrono::nanoseconds m_interval;
+    double m_tickInterval;
+    std::chrono::nanoseconds m_lag { 0 };
+};
@@ -1,36 +1,78 @@
 #include "gamewindow.h"
 
+#include "autosaver.h"
 #include "shadermanager.h"
+#include "simulationthread.h"
 #include "theme.h"
 #include "uipainter.h"
 #include "world.h"
 
-GameWindow::GameWindow(int width, int height)
+#include <spdlog/spdlog.h>
+
+namespace {
+constexpr auto AutosaveInterval = 30.0;
+} // namespace
+
+GameWindow::GameWindow(int width, int height, double tickRate, const std::string &savePath, uint32_t seed, bool headless)
     : m_width(width)
     , m_height(height)
     , m_techGraph(new TechGraph)
     , m_theme(new Theme)
-    , m_world(new World)
+    , m_world(new World(seed))
 {
     m_theme->load("assets/data/theme.json");
-    m_techGraph->load("assets/data/techgraph.json");
+    if (!m_techGraph->load("assets/data/techgraph.json")) {
+        spdlog::error("Failed to load the tech graph");
+        return;
+    }
+    m_simulation = std::make_unique<SimulationThread>(m_techGraph.get(), tickRate);
+
+    initializeGL(headless);
+
+    if (!savePath.empty()) {
+        SaveGame saveGame;
+        if (saveGame.load(savePath) && !m_world->restore(saveGame))
+            spdlog::warn("Save game {} doesn't match the tech graph, starting over", savePath);
+        m_autosaver = std::make_unique<Autosaver>(savePath);
+    }
+}
 
-    initializeGL();
+GameWindow::~GameWindow()
+{
+    if (m_autosaver)
+        m_autosaver->save(m_world->saveGame());
 }
 
-GameWindow::~GameWindow() = default;
+SaveGame GameWindow::saveGame() const
+{
+    return m_world->saveGame();
+}
 
-void GameWindow::initializeGL()
+bool GameWindow::restore(const SaveGame &saveGame)
 {
-    m_shaderManager = std::make_unique<GX::ShaderManager>();
+    return m_world->restore(saveGame);
+}
+
+void GameWindow::setSynchronousSimulation(bool synchronous)
+{
+    m_simulation->setSynchronous(synchronous);
+}
+
+void GameWindow::initializeGL(bool headless)
+{
+    if (!headless)
+        m_shaderManager = std::make_unique<GX::ShaderManager>();
     m_painter = std::make_unique<UIPainter>(m_shaderManager.get());
     m_painter->resize(m_width, m_height);
 
-    m_world->initialize(m_theme.get(), m_painter.get(), m_techGraph.get());
+    m_world->initialize(m_theme.get(), m_painter.get(), m_simulation.get());
 }
 
 void GameWindow::paintGL()
 {
+    if (!m_shaderManager)
+        return;
+
     glViewport(0, 0, m_width, m_height);
 
     const auto &clearColor = m_theme->backgroundColor;
@@ -47,9 +89,23 @@ void GameWindow::paintGL()
     m_painter->donePainting();
 }
 
+GX::SpriteBatcher *GameWindow::spriteBatcher() const
+{
+    return m_painter->spriteBatcher();
+}
+
 void GameWindow::update(double elapsed)
 {
-    m_world->update(elapsed);
+    // the simulation only moves in whole ticks on its own thread so that it
+    // doesn't depend on the frame rate, animations run on frame time
+    m_simulation->update(elapsed);
+    m_world->update(elapsed, m_simulation->lag());
+
+    m_elapsedSinceAutosave += elapsed;
+    if (m_autosaver && m_elapsedSinceAutosave >= AutosaveInterval) {
+        m_autosaver->save(m_world->saveGame());
+        m_elapsedSinceAutosave = 0.0;
+    }
 }
 
 void GameWindow::mousePressEvent(MouseButton button, const glm::vec2 &pos)
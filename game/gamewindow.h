@@ -4,13 +4,20 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <memory>
+#include <string>
 
 namespace GX {
 class ShaderManager;
+class SpriteBatcher;
 }
 
+struct SaveGame;
+
+class Autosaver;
 class UIPainter;
+class SimulationThread;
 class TechGraph;
 class Theme;
 class World;
@@ -27,25 +34,44 @@ enum class MouseButton {
 class GameWindow : private GX::NonCopyable
 {
 public:
-    GameWindow(int width, int height);
+    // Resumes the game saved at savePath and autosaves there; an empty path
+    // starts a new game and never saves. seed drives all of the game's
+    // randomness (see World). A headless window needs no GL context and
+    // never paints, everything else (input, UI state, simulation) runs as
+    // usual, e.g. for replaying recordings on machines without a display.
+    GameWindow(int width, int height, double tickRate, const std::string &savePath, uint32_t seed, bool headless = false);
     ~GameWindow();
 
+    // False if the tech graph failed to load, nothing else works then.
+    bool isValid() const { return m_simulation != nullptr; }
+
+    SaveGame saveGame() const;
+    bool restore(const SaveGame &saveGame);
+
+    // see SimulationThread::setSynchronous
+    void setSynchronousSimulation(bool synchronous);
+
     void paintGL();
     void update(double elapsed);
 
+    GX::SpriteBatcher *spriteBatcher() const; // null when headless
+
     void mousePressEvent(MouseButton button, const glm::vec2 &pos);
     void mouseReleaseEvent(MouseButton button, const glm::vec2 &pos);
     void mouseMoveEvent(const glm::vec2 &pos);
 
 private:
-    void initializeGL();
+    void initializeGL(bool headless);
     glm::vec2 mapToScene(const glm::vec2 &windowPos) const;
 
     int m_width;
     int m_height;
     std::unique_ptr<TechGraph> m_techGraph;
+    std::unique_ptr<SimulationThread> m_simulation;
     std::unique_ptr<Theme> m_theme;
     std::unique_ptr<GX::ShaderManager> m_shaderManager;
     std::unique_ptr<UIPainter> m_painter;
     std::unique_ptr<World> m_world;
+    std::unique_ptr<Autosaver> m_autosaver;
+    double m_elapsedSinceAutosave = 0.0;
 };
@@ -0,0 +1,123 @@
+#include "graphgenerator.h"
+
+#include "random.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace {
+constexpr auto BaseCost = 100.0;
+constexpr auto CostOrders = 28.0; // orders of magnitude between the first and last layer
+constexpr auto PaybackTime = 100.0; // seconds a generator takes to produce its cost
+constexpr auto LayerSpacing = 400.0f;
+constexpr auto UnitSpacing = 150.0f;
+
+std::u32string toUtf32(const std::string &s)
+{
+    return std::u32string(s.begin(), s.end());
+}
+
+void addDependency(Unit *unit, const Unit *dependency)
+{
+    if (std::find(unit->dependencies.begin(), unit->dependencies.end(), dependency) == unit->dependencies.end())
+        unit->dependencies.push_back(dependency);
+}
+} // namespace
+
+TechGraph generateTechGraph(const GraphGeneratorSettings &settings)
+{
+    Random random(settings.seed);
+    TechGraph techGraph;
+    auto &units = techGraph.units;
+
+    const auto unitCount = settings.unitCount;
+    const auto depth = std::clamp<std::size_t>(settings.depth, 1, std::max<std::size_t>(unitCount, 1));
+    const auto maxDependencies = std::max<std::size_t>(settings.maxDependencies, 1);
+    const auto layerStart = [unitCount, depth](std::size_t layer) {
+        return layer * unitCount / depth;
+    };
+
+    units.reserve(unitCount);
+    std::vector<const Unit *> generators;
+    generators.reserve(unitCount);
+    for (std::size_t layer = 0; layer < depth; ++layer) {
+        const auto start = layerStart(layer);
+        const auto end = layerStart(layer + 1);
+        const auto scale = BaseCost * std::pow(10.0, CostOrders * layer / std::max<std::size_t>(depth - 1, 1));
+
+        for (auto index = start; index < end; ++index) {
+            auto unit = std::make_unique<Unit>();
+            unit->index = index;
+            unit->sourceIndex = index;
+            unit->name = toUtf32("UNIT " + std::to_string(index));
+            unit->description = toUtf32("Generated unit in layer " + std::to_string(layer) + ".");
+
+            // the first layer only has generators so that there's something to boost
+            const auto booster = layer > 0 && !generators.empty() && random.chance(settings.boosterRatio);
+            unit->type = booster ? Unit::Type::Booster : Unit::Type::Generator;
+
+            // the first layer only costs energy, which can be harvested by hand
+            unit->baseCost.energy = scale * (0.5 + random.uniform());
+            if (layer > 0) {
+                if (random.chance(0.5))
+                    unit->baseCost.material = scale * (0.5 + random.uniform());
+                if (random.chance(0.5))
+                    unit->baseCost.extropy = scale * (0.5 + random.uniform());
+            }
+
+            if (booster) {
+                const auto *target = generators[random.below(generators.size())];
+                unit->boost = Boost { 1.1 + 0.9 * random.uniform(), { target } };
+                addDependency(unit.get(), target);
+            } else {
+                unit->boost = Boost { 1.0, {} };
+                // the very first unit makes energy, or nothing could ever be bought
+                const auto amount = scale / PaybackTime * (0.5 + random.uniform());
+                switch (index == 0 ? 0 : random.below(3)) {
+                case 0:
+                    unit->yield.energy = amount;
+                    unit->yield.carbon = 0.1 * amount * random.uniform();
+                    break;
+                case 1:
+                    unit->yield.material = amount;
+                    unit->yield.carbon = 0.1 * amount * random.uniform();
+                    break;
+                default:
+                    unit->yield.extropy = amount;
+                    break;
+                }
+                generators.push_back(unit.get());
+            }
+
+            if (layer > 0) {
+                const auto previousStart = layerStart(layer - 1);
+                const auto previousSize = start - previousStart;
+                const auto dependencyCount = 1 + random.below(maxDependencies);
+                for (std::size_t i = 0; i < dependencyCount; ++i)
+                    addDependency(unit.get(), units[previousStart + random.below(previousSize)].get());
+            }
+
+            const auto layerSize = end - start;
+            const auto position = index - start;
+            switch (settings.layout) {
+            case GraphGeneratorSettings::Layout::Layered:
+                unit->position = glm::vec2((layer - 0.5f * (depth - 1)) * LayerSpacing, (position - 0.5f * (layerSize - 1)) * UnitSpacing);
+                break;
+            case GraphGeneratorSettings::Layout::Radial: {
+                const auto radius = (layer + 1) * LayerSpacing;
+                const auto angle = 2.0f * glm::pi<float>() * position / layerSize;
+                unit->position = radius * glm::vec2(std::cos(angle), std::sin(angle));
+                break;
+            }
+            }
+
+            units.push_back(std::move(unit));
+        }
+    }
+    // can't fail, dependencies only point to earlier layers
+    techGraph.compile();
+    return techGraph;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "techgraph.h"
+
+#include <cstdint>
+
+// Random but valid tech graphs of any size for stress and scaling tests.
+//
+// Units are split evenly into layers. Units in the first layer have no
+// dependencies, every other unit depends on units of the layer before it,
+// boosters also on the generator they boost, so dependencies always point to
+// lower indices. Costs grow from 100 Wh in the first layer to ~1e30 in the
+// last one and generators pay for themselves in a couple of minutes, so the
+// graph can actually be played. The same settings and seed always give the
+// same graph.
+struct GraphGeneratorSettings {
+    enum class Layout {
+        Layered, // a column per layer
+        Radial, // a ring per layer
+    };
+
+    std::size_t unitCount = 1000;
+    std::size_t depth = 10; // number of layers
+    std::size_t maxDependencies = 2; // each unit depends on 1 to this many units
+    double boosterRatio = 0.25;
+    Layout layout = Layout::Layered;
+    uint32_t seed = 1;
+};
+
+TechGraph generateTechGraph(const GraphGeneratorSettings &settings);
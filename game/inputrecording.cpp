@@ -0,0 +1,157 @@
+#include "inputrecording.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cstring>
+#include <iterator>
+
+namespace {
+constexpr char Magic[4] = { 'Z', 'W', 'I', 'R' };
+constexpr uint32_t Version = 1;
+
+enum class Event : uint8_t {
+    Frame,
+    MousePress,
+    MouseRelease,
+    MouseMove,
+};
+
+// window coordinates are whole pixels
+void writePosition(BinaryWriter &writer, const glm::vec2 &pos)
+{
+    writer.write(static_cast<int16_t>(pos.x));
+    writer.write(static_cast<int16_t>(pos.y));
+}
+
+bool readPosition(BinaryReader &reader, glm::vec2 &pos)
+{
+    int16_t x, y;
+    if (!reader.read(x) || !reader.read(y))
+        return false;
+    pos = glm::vec2(x, y);
+    return true;
+}
+} // namespace
+
+InputRecorder::InputRecorder(const std::string &path, uint32_t seed, double tickRate, const SaveGame &saveGame)
+    : m_file(path, std::ios::binary | std::ios::trunc)
+{
+    if (!m_file) {
+        spdlog::warn("Failed to open {} for writing", path);
+        return;
+    }
+    const auto saveData = saveGame.serialize();
+    m_writer.write(Magic);
+    m_writer.write(Version);
+    m_writer.write(seed);
+    m_writer.write(tickRate);
+    m_writer.write(static_cast<uint32_t>(saveData.size()));
+    m_writer.writeBytes(saveData.data(), saveData.size());
+    flush();
+}
+
+InputRecorder::~InputRecorder()
+{
+    flush();
+}
+
+void InputRecorder::flush()
+{
+    const auto &buffer = m_writer.buffer();
+    m_file.write(buffer.data(), buffer.size());
+    m_writer.clear();
+}
+
+void InputRecorder::mousePressEvent(MouseButton button, const glm::vec2 &pos)
+{
+    m_writer.write(static_cast<uint8_t>(Event::MousePress));
+    m_writer.write(static_cast<uint8_t>(button));
+    writePosition(m_writer, pos);
+}
+
+void InputRecorder::mouseReleaseEvent(MouseButton button, const glm::vec2 &pos)
+{
+    m_writer.write(static_cast<uint8_t>(Event::MouseRelease));
+    m_writer.write(static_cast<uint8_t>(button));
+    writePosition(m_writer, pos);
+}
+
+void InputRecorder::mouseMoveEvent(const glm::vec2 &pos)
+{
+    m_writer.write(static_cast<uint8_t>(Event::MouseMove));
+    writePosition(m_writer, pos);
+}
+
+void InputRecorder::frame(double elapsed)
+{
+    m_writer.write(static_cast<uint8_t>(Event::Frame));
+    m_writer.write(elapsed);
+    flush();
+}
+
+bool InputReplayer::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        spdlog::warn("Failed to open {}", path);
+        return false;
+    }
+    m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    m_reader = BinaryReader(m_data.data(), m_data.size());
+
+    char magic[4];
+    uint32_t version;
+    if (!m_reader.read(magic) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || !m_reader.read(version)) {
+        spdlog::warn("{} is not an input recording", path);
+        return false;
+    }
+    if (version != Version) {
+        spdlog::warn("Unsupported input recording version {} in {}", version, path);
+        return false;
+    }
+    uint32_t saveSize;
+    if (!m_reader.read(m_seed) || !m_reader.read(m_tickRate) || !m_reader.read(saveSize) || m_reader.remaining() < saveSize) {
+        spdlog::warn("Truncated input recording {}", path);
+        return false;
+    }
+    if (!m_saveGame.deserialize(m_reader.position(), saveSize))
+        return false;
+    m_reader.skip(saveSize);
+    return true;
+}
+
+std::optional<double> InputReplayer::replayFrame(GameWindow *window)
+{
+    uint8_t event;
+    while (m_reader.read(event)) {
+        uint8_t button;
+        glm::vec2 position;
+        switch (static_cast<Event>(event)) {
+        case Event::Frame: {
+            double elapsed;
+            if (!m_reader.read(elapsed))
+                return {};
+            return elapsed;
+        }
+        case Event::MousePress:
+            if (!m_reader.read(button) || !readPosition(m_reader, position))
+                return {};
+            window->mousePressEvent(static_cast<MouseButton>(button), position);
+            break;
+        case Event::MouseRelease:
+            if (!m_reader.read(button) || !readPosition(m_reader, position))
+                return {};
+            window->mouseReleaseEvent(static_cast<MouseButton>(button), position);
+            break;
+        case Event::MouseMove:
+            if (!readPosition(m_reader, position))
+                return {};
+            window->mouseMoveEvent(position);
+            break;
+        default:
+            spdlog::warn("Unknown event {} in input recording", event);
+            return {};
+        }
+    }
+    return {};
+}
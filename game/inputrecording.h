@@ -0,0 +1,63 @@
+#pragma once
+
+#include "binaryio.h"
+#include "gamewindow.h"
+#include "savegame.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Log of a play session: the random seed, the tick rate and the game state
+// it started from, then the mouse events and frame times in the order the
+// game saw them. Replaying it with the same frame times reproduces the
+// session exactly, however fast it's played back.
+//
+// Events are a type byte followed by a few fixed-size little-endian fields
+// (see BinaryWriter), so a two hour session at 60 fps takes a few megabytes
+// and replays on any machine.
+
+class InputRecorder
+{
+public:
+    InputRecorder(const std::string &path, uint32_t seed, double tickRate, const SaveGame &saveGame);
+    ~InputRecorder();
+
+    bool isOpen() const { return m_file.is_open() && m_file.good(); }
+
+    void mousePressEvent(MouseButton button, const glm::vec2 &pos);
+    void mouseReleaseEvent(MouseButton button, const glm::vec2 &pos);
+    void mouseMoveEvent(const glm::vec2 &pos);
+    void frame(double elapsed);
+
+private:
+    void flush();
+
+    std::ofstream m_file;
+    BinaryWriter m_writer; // events of the current frame
+};
+
+class InputReplayer
+{
+public:
+    bool load(const std::string &path);
+
+    uint32_t seed() const { return m_seed; }
+    double tickRate() const { return m_tickRate; }
+    const SaveGame &saveGame() const { return m_saveGame; }
+
+    // Sends the input events of the next frame to the window and returns the
+    // frame time, or nothing at the end of the recording.
+    std::optional<double> replayFrame(GameWindow *window);
+
+private:
+    uint32_t m_seed = 0;
+    double m_tickRate = 0.0;
+    SaveGame m_saveGame;
+    std::vector<char> m_data;
+    BinaryReader m_reader; // over m_data
+};
@@ -6,7 +6,6 @@ namespace GX {
 
 LazyTexture::LazyTexture(const Pixmap *pixmap)
     : m_pixmap(pixmap)
-    , m_texture(pixmap->width, pixmap->height, pixmap->pixelType)
     , m_dirty(true)
 {
 }
@@ -18,11 +17,14 @@ void LazyTexture::markDirty()
 
 void LazyTexture::bind() const
 {
-    if (m_dirty) {
-        m_texture.setData(m_pixmap->pixels.data());
+    if (!m_texture) {
+        m_texture = std::make_unique<GL::Texture>(*m_pixmap);
+        m_dirty = false;
+    } else if (m_dirty) {
+        m_texture->setData(m_pixmap->pixels.data());
         m_dirty = false;
     }
-    m_texture.bind();
+    m_texture->bind();
 }
 
 const Pixmap *LazyTexture::pixmap() const
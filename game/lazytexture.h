@@ -3,10 +3,15 @@
 #include "abstracttexture.h"
 #include "texture.h"
 
+#include <memory>
+
 namespace GX {
 
 struct Pixmap;
 
+// Texture for a pixmap that's still being filled in. Uploads happen on bind,
+// and the GL texture itself is only created on the first bind, so pixmaps
+// can be packed (e.g. glyphs, to measure text) without a GL context.
 class LazyTexture : public AbstractTexture
 {
 public:
@@ -20,7 +25,7 @@ public:
 
 private:
     const Pixmap *m_pixmap;
-    GL::Texture m_texture;
+    mutable std::unique_ptr<GL::Texture> m_texture;
     mutable bool m_dirty;
 };
 
@@ -19,14 +19,14 @@ std::string shaderPath(std::string_view basename)
 } // namespace
 
 std::unique_ptr<GL::ShaderProgram>
-loadProgram(const char *vertexShader, const char *fragmentShader)
+loadProgram(const char *vertexShader, const char *fragmentShader, std::string_view defines)
 {
     auto program = std::make_unique<GL::ShaderProgram>();
-    if (!program->addShader(GL_VERTEX_SHADER, shaderPath(vertexShader))) {
+    if (!program->addShader(GL_VERTEX_SHADER, shaderPath(vertexShader), defines)) {
         spdlog::warn("Failed to add vertex shader for program {}: {}", vertexShader, program->log());
         return {};
     }
-    if (!program->addShader(GL_FRAGMENT_SHADER, shaderPath(fragmentShader))) {
+    if (!program->addShader(GL_FRAGMENT_SHADER, shaderPath(fragmentShader), defines)) {
         spdlog::warn("Failed to add fragment shader for program {}: {}", fragmentShader, program->log());
         return {};
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <string_view>
 
 namespace GX {
 
@@ -8,6 +9,7 @@ namespace GL {
 class ShaderProgram;
 }
 
-std::unique_ptr<GL::ShaderProgram> loadProgram(const char *vertexShader, const char *fragmentShader);
+// defines ("#define X\n" lines) are added to both shaders
+std::unique_ptr<GL::ShaderProgram> loadProgram(const char *vertexShader, const char *fragmentShader, std::string_view defines = {});
 
 } // namespace GX
@@ -8,9 +8,15 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <random>
+#include <thread>
 
 #include "gamewindow.h"
+#include "inputrecording.h"
+#include "spritebatcher.h"
 
 using namespace std::string_literals;
 
@@ -92,10 +98,14 @@ const char *glDebugSeverity(GLenum severity)
 }
 #endif
 
+constexpr auto SavePath = "zettawatt.sav";
+
 static std::unique_ptr<GameWindow> gameWindow;
+static std::unique_ptr<InputRecorder> inputRecorder;
 } // namespace
 
-static bool processEvents()
+// While replaying only quitting is handled, the input comes from the recording.
+static bool processEvents(bool replaying = false)
 {
     SDL_Event event;
     const auto mouseButton = [&event] {
@@ -116,18 +126,31 @@ static bool processEvents()
     };
 
     while (SDL_PollEvent(&event)) {
+        if (replaying && event.type != SDL_QUIT)
+            continue;
         switch (event.type) {
         case SDL_MOUSEBUTTONDOWN: {
-            gameWindow->mousePressEvent(mouseButton(), glm::vec2(event.button.x, event.button.y));
+            const auto pos = glm::vec2(event.button.x, event.button.y);
+            if (inputRecorder)
+                inputRecorder->mousePressEvent(mouseButton(), pos);
+            gameWindow->mousePressEvent(mouseButton(), pos);
             break;
         }
         case SDL_MOUSEBUTTONUP:
-            if (event.button.button == SDL_BUTTON_LEFT)
-                gameWindow->mouseReleaseEvent(mouseButton(), glm::vec2(event.button.x, event.button.y));
+            if (event.button.button == SDL_BUTTON_LEFT) {
+                const auto pos = glm::vec2(event.button.x, event.button.y);
+                if (inputRecorder)
+                    inputRecorder->mouseReleaseEvent(mouseButton(), pos);
+                gameWindow->mouseReleaseEvent(mouseButton(), pos);
+            }
             break;
-        case SDL_MOUSEMOTION:
-            gameWindow->mouseMoveEvent(glm::vec2(event.motion.x, event.motion.y));
+        case SDL_MOUSEMOTION: {
+            const auto pos = glm::vec2(event.motion.x, event.motion.y);
+            if (inputRecorder)
+                inputRecorder->mouseMoveEvent(pos);
+            gameWindow->mouseMoveEvent(pos);
             break;
+        }
         case SDL_QUIT:
             return false;
         }
@@ -135,21 +158,61 @@ static bool processEvents()
     return true;
 }
 
-int main()
+#ifndef __EMSCRIPTEN__
+// Plays back a recorded session with the recorded frame times, as fast as
+// possible or paced to the recording, and reports how long the frames took.
+static void replay(InputReplayer &replayer, bool realTime, bool paint)
 {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        panic("Video initialization failed: %s", SDL_GetError());
-        return 1;
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    double playTime = 0.0;
+    double worstFrame = 0.0;
+    std::size_t frames = 0;
+    // without painting there's no window, and so no events either
+    while (!paint || processEvents(true)) {
+        const auto elapsed = replayer.replayFrame(gameWindow.get());
+        if (!elapsed)
+            break;
+        const auto frameStart = Clock::now();
+        gameWindow->update(*elapsed);
+        if (paint)
+            gameWindow->paintGL();
+        worstFrame = std::max(worstFrame, std::chrono::duration<double>(Clock::now() - frameStart).count());
+        ++frames;
+        playTime += *elapsed;
+        if (paint)
+            SDL_GL_SwapBuffers();
+        if (realTime)
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(playTime)));
+    }
+    const auto wallTime = std::chrono::duration<double>(Clock::now() - start).count();
+    spdlog::info("Replayed {} frames ({:.1f} s of play) in {:.3f} s, {:.3f} ms per frame, worst {:.3f} ms",
+                 frames, playTime, wallTime, frames ? 1000.0 * wallTime / frames : 0.0, 1000.0 * worstFrame);
+    if (paint && frames) {
+        const auto &statistics = gameWindow->spriteBatcher()->statistics();
+        spdlog::info("Rendered {:.0f} quads in {:.1f} draw calls per frame, {:.1f} KB uploaded per frame, {:.3f} ms per frame in the sprite batcher",
+                     static_cast<double>(statistics.quads) / frames, static_cast<double>(statistics.drawCalls) / frames,
+                     statistics.bytesUploaded / 1024.0 / frames, 1000.0 * statistics.seconds / frames);
     }
 
+    // for comparing runs
+    const auto saveGame = gameWindow->saveGame();
+    const auto &state = saveGame.state;
+    spdlog::info("Final state: extropy {}, energy {}, material {}, carbon {}",
+                 static_cast<double>(state.extropy), static_cast<double>(state.energy), static_cast<double>(state.material), static_cast<double>(state.carbon));
+}
+#endif
+
+// Opens the window and sets up the GL context.
+static void createWindow(int width, int height)
+{
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+        panic("Video initialization failed: %s", SDL_GetError());
+
     const SDL_VideoInfo *info = SDL_GetVideoInfo();
-    if (!info) {
+    if (!info)
         panic("Video query failed: %s\n", SDL_GetError());
-        return 1;
-    }
 
-    const int width = 1280;
-    const int height = 720;
     const int bpp = info->vfmt->BitsPerPixel;
     const Uint32 flags = SDL_OPENGL;
 
@@ -158,16 +221,12 @@ int main()
     SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 5);
     SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 16);
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-    if (!SDL_SetVideoMode(width, height, bpp, flags)) {
+    if (!SDL_SetVideoMode(width, height, bpp, flags))
         panic("Video mode set failed: %s\n", SDL_GetError());
-        return 1;
-    }
 
     auto error = glewInit();
-    if (error != GLEW_OK) {
+    if (error != GLEW_OK)
         panic("Failed to initialize GLEW: %s\n", glewGetErrorString(error));
-        return 1;
-    }
 
 #ifndef __EMSCRIPTEN__
     glEnable(GL_DEBUG_OUTPUT);
@@ -180,8 +239,60 @@ int main()
             },
             nullptr);
 #endif
+}
+
+int main(int argc, char *argv[])
+{
+    constexpr auto DefaultTickRate = 60.0;
+    double tickRate = DefaultTickRate;
+    std::string recordPath;
+    std::string replayPath;
+    bool realTime = false;
+    bool paint = true;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] == "--tick-rate"s && i + 1 < argc)
+            tickRate = std::atof(argv[++i]);
+        else if (argv[i] == "--record"s && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (argv[i] == "--replay"s && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (argv[i] == "--real-time"s)
+            realTime = true;
+        else if (argv[i] == "--no-paint"s)
+            paint = false;
+    }
+    if (!(tickRate > 0.0)) {
+        spdlog::warn("Invalid tick rate, using {}", DefaultTickRate);
+        tickRate = DefaultTickRate;
+    }
+
+    // the game only uses randomness for effects and harvesting, seeding it
+    // is enough to make a session reproducible, on any platform (see Random)
+    InputReplayer replayer;
+    uint32_t seed = 1;
+    if (!replayPath.empty()) {
+        if (!replayer.load(replayPath))
+            return 1;
+        seed = replayer.seed();
+        tickRate = replayer.tickRate();
+    } else if (!recordPath.empty()) {
+        seed = std::random_device()();
+    }
 
-    gameWindow.reset(new GameWindow(width, height));
+    const int width = 1280;
+    const int height = 720;
+    // a replay without painting needs no window or GL context, so it runs on
+    // machines without a display
+    const auto headless = !replayPath.empty() && !paint;
+    if (!headless)
+        createWindow(width, height);
+
+    // a replay starts from the recorded state and leaves the save game alone
+    gameWindow.reset(new GameWindow(width, height, tickRate, replayPath.empty() ? SavePath : "", seed, headless));
+    if (!gameWindow->isValid()) {
+        panic("Failed to load the tech graph\n");
+        return 1;
+    }
 
 #ifdef __EMSCRIPTEN__
     emscripten_request_animation_frame_loop(
@@ -201,19 +312,42 @@ int main()
             },
             nullptr);
 #else
+    if (!replayPath.empty()) {
+        gameWindow->setSynchronousSimulation(true);
+        if (!gameWindow->restore(replayer.saveGame()))
+            spdlog::warn("Input recording {} doesn't match the tech graph", replayPath);
+        else
+            replay(replayer, realTime, paint);
+        gameWindow.reset();
+        SDL_Quit();
+        return 0;
+    }
+
+    if (!recordPath.empty()) {
+        inputRecorder = std::make_unique<InputRecorder>(recordPath, seed, tickRate, gameWindow->saveGame());
+        if (!inputRecorder->isOpen())
+            inputRecorder.reset();
+        else
+            gameWindow->setSynchronousSimulation(true); // the replay has to see the same snapshots
+    }
+
     while (processEvents()) {
         const auto elapsed = [] {
-            static Uint32 last = 0;
-            const Uint32 now = SDL_GetTicks();
-            const Uint32 elapsed = last != 0 ? now - last : 0;
+            using Clock = std::chrono::steady_clock;
+            static auto last = Clock::now();
+            const auto now = Clock::now();
+            const auto elapsed = now - last;
             last = now;
-            return static_cast<double>(elapsed) / 1000.0;
+            return std::chrono::duration<double>(elapsed).count();
         }();
+        if (inputRecorder)
+            inputRecorder->frame(elapsed);
         gameWindow->update(elapsed);
         gameWindow->paintGL();
         SDL_GL_SwapBuffers();
     }
 
+    inputRecorder.reset();
     gameWindow.reset();
 
     SDL_Quit();
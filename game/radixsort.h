@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace GX {
+
+// LSD radix sort of 64 bit keys a byte at a time, stable. Only the bits from
+// firstBit up are sorted on; keys whose lower bits must be in order too have
+// to come in already ordered by them, as sprite draw keys do (their lowest
+// bits are the submission sequence, see SpriteBatcher). The histograms of
+// all digits are built in one pass up front, and digits that are the same
+// in every key are skipped. scratch must hold count keys; the result ends up
+// in keys.
+inline void radixSort(uint64_t *keys, uint64_t *scratch, std::size_t count, int firstBit = 0)
+{
+    constexpr auto MaxDigitCount = sizeof(uint64_t);
+    const auto digitCount = (64 - firstBit + 7) / 8;
+    std::array<std::array<std::size_t, 256>, MaxDigitCount> histograms = {};
+    for (std::size_t i = 0; i < count; ++i) {
+        auto key = keys[i] >> firstBit;
+        for (int digit = 0; digit < digitCount; ++digit) {
+            ++histograms[digit][key & 0xff];
+            key >>= 8;
+        }
+    }
+
+    auto *source = keys;
+    auto *destination = scratch;
+    for (int digit = 0; digit < digitCount; ++digit) {
+        auto &histogram = histograms[digit];
+        const auto shift = firstBit + 8 * digit;
+        if (count == 0 || histogram[(source[0] >> shift) & 0xff] == count)
+            continue;
+        // bucket sizes to bucket offsets
+        std::size_t offset = 0;
+        for (auto &bucket : histogram)
+            offset += std::exchange(bucket, offset);
+        for (std::size_t i = 0; i < count; ++i)
+            destination[histogram[(source[i] >> shift) & 0xff]++] = source[i];
+        std::swap(source, destination);
+    }
+    if (source != keys)
+        std::copy(source, source + count, keys);
+}
+
+} // namespace GX
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+// Seeded random numbers that come out the same on every platform, for
+// generated graphs and for anything a replay has to reproduce. mt19937
+// output is the same everywhere, std::rand and the standard distributions
+// aren't, so the few draws needed are done by hand.
+class Random
+{
+public:
+    explicit Random(uint32_t seed)
+        : m_generator(seed)
+    {
+    }
+
+    // [0, 1)
+    double uniform() { return m_generator() / 4294967296.0; }
+    // [min, max)
+    double uniform(double min, double max) { return min + (max - min) * uniform(); }
+    // [0, n)
+    std::size_t below(std::size_t n) { return static_cast<std::size_t>(uniform() * n); }
+    bool chance(double p) { return uniform() < p; }
+
+private:
+    std::mt19937 m_generator;
+};
@@ -0,0 +1,244 @@
+#include "savegame.h"
+
+#include "binaryio.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace {
+constexpr char Magic[4] = { 'Z', 'W', 'S', 'V' };
+constexpr uint32_t Version = 1;
+
+// always as a BigReal, so the files don't depend on the REAL option
+void writeReal(BinaryWriter &writer, const Real &value)
+{
+    const BigReal bigValue(value);
+    writer.write(bigValue.mantissa());
+    writer.write(bigValue.exponent());
+}
+
+bool readReal(BinaryReader &reader, Real &value)
+{
+    double mantissa;
+    int32_t exponent;
+    if (!reader.read(mantissa) || !reader.read(exponent))
+        return false;
+    value = static_cast<Real>(BigReal::fromParts(mantissa, exponent));
+    return true;
+}
+
+// Resource amounts are never negative, and must still be finite after
+// narrowing to the build's Real type.
+template<typename T>
+bool isValidAmount(const T &value)
+{
+    if constexpr (std::is_same_v<T, BigReal>)
+        return std::isfinite(value.mantissa()) && value.mantissa() >= 0.0;
+    else
+        return std::isfinite(value) && value >= 0;
+}
+
+// Read-only view of a whole file, memory-mapped where available.
+class FileView
+{
+public:
+    explicit FileView(const std::string &path)
+    {
+#ifdef USE_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *mapping = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                m_data = static_cast<const char *>(mapping);
+                m_size = st.st_size;
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return;
+        m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#endif
+    }
+
+    ~FileView()
+    {
+#ifdef USE_MMAP
+        if (m_data)
+            ::munmap(const_cast<char *>(m_data), m_size);
+#endif
+    }
+
+    FileView(const FileView &) = delete;
+    FileView &operator=(const FileView &) = delete;
+
+    const char *data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    const char *m_data = nullptr;
+    std::size_t m_size = 0;
+#ifndef USE_MMAP
+    std::vector<char> m_buffer;
+#endif
+};
+
+#ifdef _WIN32
+std::wstring widePath(const std::string &path)
+{
+    const auto size = ::MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    if (size <= 0)
+        return {};
+    std::wstring result(size, L'\0');
+    ::MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, result.data(), size);
+    result.pop_back(); // the terminator
+    return result;
+}
+#endif
+
+// Atomically, so there's always either the old or the new file at to.
+bool replaceFile(const std::string &from, const std::string &to)
+{
+#ifdef _WIN32
+    // std::rename doesn't replace existing files on Windows
+    return ::MoveFileExW(widePath(from).c_str(), widePath(to).c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+} // namespace
+
+std::vector<char> SaveGame::serialize() const
+{
+    BinaryWriter writer;
+    writer.write(Magic);
+    writer.write(Version);
+    writer.write(static_cast<int32_t>(gameState));
+    writer.write(viewOffset.x);
+    writer.write(viewOffset.y);
+    writer.write(viewScale);
+    writeReal(writer, state.extropy);
+    writeReal(writer, state.energy);
+    writeReal(writer, state.material);
+    writeReal(writer, state.carbon);
+    writer.write(static_cast<uint32_t>(counts.size()));
+    for (const auto count : counts)
+        writer.write(static_cast<int32_t>(count));
+    return writer.buffer();
+}
+
+bool SaveGame::save(const std::string &path) const
+{
+    const auto buffer = serialize();
+
+    // write to a temporary file first so that a crash never leaves a truncated save behind
+    const auto tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            spdlog::warn("Failed to open {} for writing", tempPath);
+            return false;
+        }
+        file.write(buffer.data(), buffer.size());
+        if (!file) {
+            spdlog::warn("Failed to write {}", tempPath);
+            return false;
+        }
+    }
+    if (!replaceFile(tempPath, path)) {
+        spdlog::warn("Failed to rename {} to {}", tempPath, path);
+        return false;
+    }
+    return true;
+}
+
+bool SaveGame::load(const std::string &path)
+{
+    FileView file(path);
+    if (!file.data())
+        return false;
+    if (!deserialize(file.data(), file.size())) {
+        spdlog::warn("Failed to load save game {}", path);
+        return false;
+    }
+    return true;
+}
+
+bool SaveGame::deserialize(const char *data, std::size_t size)
+{
+    BinaryReader reader(data, size);
+    char magic[4];
+    uint32_t version;
+    if (!reader.read(magic) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || !reader.read(version)) {
+        spdlog::warn("Not a save game");
+        return false;
+    }
+    if (version != Version) {
+        spdlog::warn("Unsupported save game version {}", version);
+        return false;
+    }
+
+    SaveGame saveGame;
+    int32_t gameState;
+    uint32_t unitCount;
+    if (!reader.read(gameState) || !reader.read(saveGame.viewOffset.x) || !reader.read(saveGame.viewOffset.y) || !reader.read(saveGame.viewScale)
+        || !readReal(reader, saveGame.state.extropy) || !readReal(reader, saveGame.state.energy) || !readReal(reader, saveGame.state.material) || !readReal(reader, saveGame.state.carbon)
+        || !reader.read(unitCount)) {
+        spdlog::warn("Truncated save game");
+        return false;
+    }
+    const auto &state = saveGame.state;
+    if (!std::isfinite(saveGame.viewOffset.x) || !std::isfinite(saveGame.viewOffset.y) || !std::isfinite(saveGame.viewScale) || !(saveGame.viewScale > 0.0f)
+        || !isValidAmount(state.extropy) || !isValidAmount(state.energy) || !isValidAmount(state.material) || !isValidAmount(state.carbon)) {
+        spdlog::warn("Corrupt save game");
+        return false;
+    }
+    // before allocating anything, the count comes straight from the file
+    if (unitCount > reader.remaining() / sizeof(int32_t)) {
+        spdlog::warn("Truncated save game");
+        return false;
+    }
+    saveGame.gameState = gameState;
+    saveGame.counts.resize(unitCount);
+    for (auto &count : saveGame.counts) {
+        int32_t value;
+        if (!reader.read(value)) {
+            spdlog::warn("Truncated save game");
+            return false;
+        }
+        if (value < 0) {
+            spdlog::warn("Corrupt save game");
+            return false;
+        }
+        count = value;
+    }
+
+    *this = std::move(saveGame);
+    return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "techgraph.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Everything needed to resume a game. Stored as a small versioned binary
+// file (little-endian, fixed-size fields) that loads straight from a memory
+// mapping.
+struct SaveGame {
+    std::vector<int> counts; // per unit, in graph file order (Unit::sourceIndex)
+    StateVector state;
+    glm::vec2 viewOffset = glm::vec2(0);
+    float viewScale = 1.0f;
+    int gameState = 0;
+
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+
+    // The file contents in memory, e.g. to embed a save game in another file.
+    std::vector<char> serialize() const;
+    bool deserialize(const char *data, std::size_t size);
+};
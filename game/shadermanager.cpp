@@ -32,8 +32,15 @@ loadProgram(ShaderManager::Program id)
     };
     static_assert(std::extent_v<decltype(programSources)> == ShaderManager::NumPrograms, "expected number of programs to match");
 
+    // the shaders take the vertex layout SpriteBatcher was built with
+    static constexpr const char *defines =
+#ifdef SPRITE_INSTANCING
+            "#define SPRITE_INSTANCING\n"
+#endif
+            "";
+
     const auto &sources = programSources[id];
-    return GX::loadProgram(sources.vertexShader, sources.fragmentShader);
+    return GX::loadProgram(sources.vertexShader, sources.fragmentShader, defines);
 }
 
 } // namespace
@@ -1,6 +1,7 @@
 #include "shaderprogram.h"
 #include "ioutil.h"
 
+#include <algorithm>
 #include <array>
 #include <fstream>
 #include <memory>
@@ -22,7 +23,7 @@ ShaderProgram::~ShaderProgram()
     glDeleteProgram(m_id);
 }
 
-bool ShaderProgram::addShader(GLenum type, const std::string &filename)
+bool ShaderProgram::addShader(GLenum type, const std::string &filename, std::string_view defines)
 {
     auto source = Util::readFile(filename);
     if (!source) {
@@ -31,6 +32,12 @@ bool ShaderProgram::addShader(GLenum type, const std::string &filename)
         m_log = ss.str();
         return false;
     }
+    if (!defines.empty()) {
+        auto versionEnd = std::find(source->begin(), source->end(), '\n');
+        if (versionEnd != source->end())
+            ++versionEnd;
+        source->insert(versionEnd, defines.begin(), defines.end());
+    }
     source->push_back('\0');
     return addShaderSource(type, reinterpret_cast<const GLchar *>(source->data()));
 }
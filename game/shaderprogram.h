@@ -20,7 +20,8 @@ public:
     ShaderProgram();
     ~ShaderProgram();
 
-    bool addShader(GLenum type, const std::string &path);
+    // defines go right after the #version line, which has to come first
+    bool addShader(GLenum type, const std::string &path, std::string_view defines = {});
     bool addShaderSource(GLenum type, const GLchar *source);
     bool link();
     const std::string &log() const;
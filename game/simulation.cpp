@@ -0,0 +1,297 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr auto Never = std::numeric_limits<double>::infinity();
+
+bool isAffordable(const StateVector &cost, const StateVector &state)
+{
+    return cost.extropy <= state.extropy && cost.energy <= state.energy && cost.material <= state.material;
+}
+} // namespace
+
+Simulation::Simulation(const TechGraph *techGraph)
+    : m_techGraph(techGraph)
+    , m_units(techGraph)
+{
+    m_boostQueued.assign(m_units.size(), false);
+    reset();
+}
+
+Simulation::~Simulation() = default;
+
+void Simulation::reset()
+{
+    m_units.resetCounts();
+    m_boostMultipliers.assign(m_units.size(), 1.0);
+    m_effectiveBoosts.assign(m_units.size(), 1.0);
+    m_state = {};
+    updateStateDelta();
+    countsChanged();
+    checkpoint();
+}
+
+bool Simulation::restore(const std::vector<int> &counts, const StateVector &state)
+{
+    if (counts.size() != m_units.size())
+        return false;
+    m_units.resetCounts();
+    for (std::size_t i = 0; i < counts.size(); ++i)
+        m_units.setCount(i, std::max(counts[i], 0));
+    m_state = state;
+    updateStateDelta();
+    countsChanged();
+    checkpoint();
+    return true;
+}
+
+void Simulation::update(double elapsed)
+{
+    fastForward(elapsed);
+}
+
+void Simulation::fastForward(double seconds)
+{
+    // always integrate from the last checkpoint so that rounding errors don't
+    // pile up over many small steps
+    m_elapsedSinceCheckpoint += seconds;
+    m_state = m_checkpointState + m_stateDelta * m_elapsedSinceCheckpoint;
+
+    if (m_schedule.empty() || m_schedule.top().time > m_elapsedSinceCheckpoint)
+        return;
+    do {
+        m_schedule.pop();
+        ++m_acquirableCount;
+    } while (!m_schedule.empty() && m_schedule.top().time <= m_elapsedSinceCheckpoint);
+}
+
+StateVector Simulation::stateAfter(double seconds) const
+{
+    return m_checkpointState + m_stateDelta * (m_elapsedSinceCheckpoint + seconds);
+}
+
+void Simulation::checkpoint()
+{
+    m_checkpointState = m_state;
+    m_elapsedSinceCheckpoint = 0.0;
+    updateSchedule();
+    ++m_epochs.state;
+}
+
+void Simulation::countsChanged()
+{
+    // a unit's cost only depends on its count
+    ++m_epochs.counts;
+    ++m_epochs.costs;
+}
+
+void Simulation::updateSchedule()
+{
+    m_units.timesUntilAffordable(m_checkpointState, m_stateDelta, m_acquirableAt);
+    m_acquirableCount = 0;
+    std::vector<AcquirableEvent> events;
+    for (std::size_t i = 0; i < m_units.size(); ++i) {
+        const auto time = acquirableAfterCheckpoint(i, m_acquirableAt[i]);
+        m_acquirableAt[i] = time;
+        if (time == 0.0)
+            ++m_acquirableCount;
+        else if (time != Never)
+            events.push_back({ time, i });
+    }
+    m_schedule = decltype(m_schedule)(std::greater<AcquirableEvent>(), std::move(events));
+}
+
+double Simulation::acquirableAfterCheckpoint(std::size_t index, double estimate) const
+{
+    if (estimate == Never)
+        return Never;
+    if (m_units.isBooster[index] && m_units.counts[index] > 0)
+        return Never;
+    if (!m_units.unlocked[index])
+        return Never;
+    // the estimate is computed in double precision and the division can round
+    // down; nudge it until the state computed by fastForward actually covers
+    // the cost, it's only ever a few ulps off
+    constexpr auto MaxNudges = 64;
+    const auto cost = m_units.cost(index);
+    if (estimate == 0.0 && isAffordable(cost, m_checkpointState))
+        return 0.0;
+    auto time = estimate;
+    for (int i = 0; !isAffordable(cost, m_checkpointState + m_stateDelta * time); ++i) {
+        if (i == MaxNudges)
+            return Never; // cost isn't a number
+        time = std::nextafter(time, Never);
+    }
+    return time;
+}
+
+bool Simulation::acquire(const Unit *unit, int amount)
+{
+    if (amount < 1 || !canAcquire(unit))
+        return false;
+    const auto cost = this->cost(unit, amount);
+    if (amount > 1 && (unit->type == Unit::Type::Booster || !isAffordable(cost, m_state)))
+        return false;
+    m_state -= cost;
+    m_units.setCount(unit->index, count(unit) + amount);
+    switch (unit->type) {
+    case Unit::Type::Generator:
+        m_stateDelta += amount * m_boostMultipliers[unit->index] * unit->yield;
+        break;
+    case Unit::Type::Booster:
+        updateBoostMultipliers(unit->index);
+        break;
+    }
+    countsChanged();
+    checkpoint();
+    return true;
+}
+
+int Simulation::maxAcquirable(const Unit *unit) const
+{
+    if (!canAcquire(unit))
+        return 0;
+    if (unit->type == Unit::Type::Booster)
+        return 1;
+    // costs are doubles, past this many copies they overflow
+    const auto maxCount = static_cast<int>(std::log(std::numeric_limits<double>::max()) / std::log(m_units.costGrowth));
+    const auto limit = std::max(maxCount - count(unit), 1);
+    auto amount = std::clamp(m_units.maxAffordable(unit->index, m_state), 1, limit);
+    // the closed form is only off by rounding, so this is at most a step or two
+    while (amount > 1 && !isAffordable(cost(unit, amount), m_state))
+        --amount;
+    while (amount < limit && isAffordable(cost(unit, amount + 1), m_state))
+        ++amount;
+    return amount;
+}
+
+void Simulation::addEnergy(Real amount)
+{
+    m_state.energy += amount;
+    checkpoint();
+}
+
+bool Simulation::canAcquire(const Unit *unit) const
+{
+    return m_acquirableAt[unit->index] <= m_elapsedSinceCheckpoint;
+}
+
+double Simulation::timeUntilAcquirable(const Unit *unit) const
+{
+    return std::max(m_acquirableAt[unit->index] - m_elapsedSinceCheckpoint, 0.0);
+}
+
+void Simulation::snapshot(SimulationSnapshot &snapshot) const
+{
+    const auto unitCount = m_units.size();
+    snapshot.state = m_state;
+    snapshot.stateDelta = m_stateDelta;
+    snapshot.checkpointState = m_checkpointState;
+    snapshot.elapsedSinceCheckpoint = m_elapsedSinceCheckpoint;
+    if (snapshot.epochs.counts != m_epochs.counts) {
+        snapshot.counts = m_units.counts;
+        snapshot.unlocked.resize(unitCount);
+        for (std::size_t i = 0; i < unitCount; ++i)
+            snapshot.unlocked[i] = m_units.unlocked[i];
+    }
+    if (snapshot.epochs.costs != m_epochs.costs) {
+        snapshot.costs.resize(unitCount);
+        for (std::size_t i = 0; i < unitCount; ++i)
+            snapshot.costs[i] = m_units.cost(i);
+    }
+    // only rescheduled at checkpoints
+    if (snapshot.epochs.state != m_epochs.state)
+        snapshot.acquirableAt = m_acquirableAt;
+    snapshot.anyAcquirable = anyAcquirable();
+    snapshot.anyAcquired = anyAcquired();
+    snapshot.epochs = m_epochs;
+}
+
+StateVector Simulation::boostGain(const Unit *booster) const
+{
+    if (booster->type != Unit::Type::Booster || count(booster) > 0)
+        return {};
+    return boostGain(booster->index, m_effectiveBoosts[booster->index]);
+}
+
+// Production gained if the multipliers of the booster's targets were scaled
+// by ratio. Boosters among the targets pass on the change of their own
+// effective factor.
+StateVector Simulation::boostGain(std::size_t booster, double ratio) const
+{
+    StateVector gain;
+    for (auto i = m_units.boostTargetOffsets[booster]; i < m_units.boostTargetOffsets[booster + 1]; ++i) {
+        const auto target = m_units.boostTargets[i];
+        const auto multiplier = m_boostMultipliers[target];
+        if (!m_units.isBooster[target]) {
+            gain += m_units.counts[target] * multiplier * (ratio - 1.0) * m_techGraph->units[target]->yield;
+        } else if (m_units.counts[target] > 0 && m_effectiveBoosts[target] > 0.0) {
+            gain += boostGain(target, effectiveBoost(target, multiplier * ratio) / m_effectiveBoosts[target]);
+        }
+    }
+    return gain;
+}
+
+double Simulation::effectiveBoost(std::size_t booster, double multiplier) const
+{
+    return std::max(1.0 + (m_units.boostFactors[booster] - 1.0) * multiplier, 0.0);
+}
+
+// Refreshes the multipliers of everything downstream of a booster that was
+// just acquired. Units are visited in boost order, so each one is only
+// recomputed once its own boosters are up to date, and the walk stops
+// wherever nothing changed.
+void Simulation::updateBoostMultipliers(std::size_t acquired)
+{
+    const auto enqueueTargets = [this](std::size_t unit) {
+        for (auto i = m_units.boostTargetOffsets[unit]; i < m_units.boostTargetOffsets[unit + 1]; ++i) {
+            const auto target = m_units.boostTargets[i];
+            if (!m_boostQueued[target]) {
+                m_boostQueued[target] = true;
+                m_boostQueue.push(m_units.boostRanks[target]);
+            }
+        }
+    };
+    enqueueTargets(acquired);
+    while (!m_boostQueue.empty()) {
+        const auto index = m_units.boostOrder[m_boostQueue.top()];
+        m_boostQueue.pop();
+        m_boostQueued[index] = false;
+
+        double multiplier = 1.0;
+        for (auto i = m_units.boosterOffsets[index]; i < m_units.boosterOffsets[index + 1]; ++i) {
+            const auto booster = m_units.boosters[i];
+            if (m_units.counts[booster] > 0)
+                multiplier *= m_effectiveBoosts[booster];
+        }
+        if (multiplier == m_boostMultipliers[index])
+            continue;
+        if (m_units.isBooster[index]) {
+            m_effectiveBoosts[index] = effectiveBoost(index, multiplier);
+            if (m_units.counts[index] > 0)
+                enqueueTargets(index);
+        } else {
+            m_stateDelta += m_units.counts[index] * (multiplier - m_boostMultipliers[index]) * m_techGraph->units[index]->yield;
+        }
+        m_boostMultipliers[index] = multiplier;
+    }
+}
+
+// Full recomputation, only needed when the counts change wholesale.
+void Simulation::updateStateDelta()
+{
+    for (const auto index : m_units.boostOrder) {
+        double multiplier = 1.0;
+        for (auto i = m_units.boosterOffsets[index]; i < m_units.boosterOffsets[index + 1]; ++i) {
+            const auto booster = m_units.boosters[i];
+            if (m_units.counts[booster] > 0)
+                multiplier *= m_effectiveBoosts[booster];
+        }
+        m_boostMultipliers[index] = multiplier;
+        m_effectiveBoosts[index] = m_units.isBooster[index] ? effectiveBoost(index, multiplier) : 1.0;
+    }
+    m_stateDelta = m_units.production(m_boostMultipliers);
+}
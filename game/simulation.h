@@ -0,0 +1,140 @@
+#pragma once
+
+#include "techgraph.h"
+#include "unitstore.h"
+
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+// Counters bumped whenever the matching part of the simulation changes, so
+// that the UI can cache whatever it derives from them (formatted text,
+// layout) and only rebuild it when an epoch moves on.
+struct SimulationEpochs {
+    uint64_t state = 0; // checkpoint state or its rate of change; in between the state just grows linearly
+    uint64_t counts = 0;
+    uint64_t costs = 0; // of the next copy of each unit
+};
+
+// Copy of everything the UI reads from the simulation, so that it can be
+// painted while the simulation moves on (see SimulationThread).
+struct SimulationSnapshot {
+    uint64_t tick = 0; // ticks simulated so far
+    uint64_t commandCount = 0; // SimulationThread commands processed so far
+
+    StateVector state;
+    StateVector stateDelta;
+    StateVector checkpointState;
+    double elapsedSinceCheckpoint = 0.0;
+    std::vector<int> counts;
+    std::vector<StateVector> costs; // of the next copy of each unit
+    std::vector<double> acquirableAt; // see Simulation::m_acquirableAt
+    std::vector<uint8_t> unlocked;
+    bool anyAcquirable = false;
+    bool anyAcquired = false;
+    SimulationEpochs epochs;
+
+    // same as Simulation::stateAfter
+    StateVector stateAfter(double seconds) const { return checkpointState + stateDelta * (elapsedSinceCheckpoint + seconds); }
+
+    int count(const Unit *unit) const { return counts[unit->index]; }
+    StateVector cost(const Unit *unit) const { return costs[unit->index]; }
+    bool canAcquire(const Unit *unit) const { return acquirableAt[unit->index] <= elapsedSinceCheckpoint; }
+    bool isUnlocked(const Unit *unit) const { return unlocked[unit->index]; }
+};
+
+// Game economy without any rendering: unit counts, resources and the rules
+// for acquiring units. World is just a view over this.
+class Simulation
+{
+public:
+    explicit Simulation(const TechGraph *techGraph);
+    ~Simulation();
+
+    void reset();
+    void update(double elapsed);
+
+    // Replaces counts and state, e.g. from a save game. Fails if the counts
+    // don't match the graph.
+    bool restore(const std::vector<int> &counts, const StateVector &state);
+
+    // Production is linear between purchases, so any amount of time can be
+    // skipped in one step (e.g. offline progress).
+    void fastForward(double seconds);
+    StateVector stateAfter(double seconds) const;
+
+    // Buys amount copies of the unit at once, or nothing if they aren't all
+    // affordable.
+    bool acquire(const Unit *unit, int amount = 1);
+    bool canAcquire(const Unit *unit) const;
+    int maxAcquirable(const Unit *unit) const;
+    void addEnergy(Real amount);
+
+    int count(const Unit *unit) const { return m_units.counts[unit->index]; }
+    StateVector cost(const Unit *unit, int amount = 1) const { return m_units.cost(unit->index, amount); }
+    bool isUnlocked(const Unit *unit) const { return m_units.unlocked[unit->index]; }
+
+    // Product of the effective factors of the acquired boosters targeting
+    // the unit.
+    double boostMultiplier(const Unit *unit) const { return m_boostMultipliers[unit->index]; }
+    // Factor a booster applies to its targets once acquired, after its own
+    // boosters scaled it (see Boost).
+    double effectiveBoost(const Unit *booster) const { return m_effectiveBoosts[booster->index]; }
+    // Production the booster would add if it were acquired now, including
+    // what it adds through the boosters it boosts. Zero if it's owned.
+    StateVector boostGain(const Unit *booster) const;
+
+    // Seconds until the unit can be acquired at the current production rate,
+    // zero if it can be acquired right now, infinity if it never will.
+    double timeUntilAcquirable(const Unit *unit) const;
+
+    bool anyAcquirable() const { return m_acquirableCount > 0; }
+    bool anyAcquired() const { return m_units.ownedCount > 0; }
+
+    const TechGraph *techGraph() const { return m_techGraph; }
+    const std::vector<int> &counts() const { return m_units.counts; }
+    StateVector state() const { return m_state; }
+    StateVector stateDelta() const { return m_stateDelta; }
+    const SimulationEpochs &epochs() const { return m_epochs; }
+
+    // Fills everything but the tick and command counts, reusing the
+    // snapshot's storage. The per-unit arrays are only copied when the epochs
+    // say they changed since the snapshot was last filled.
+    void snapshot(SimulationSnapshot &snapshot) const;
+
+private:
+    void updateStateDelta();
+    void updateBoostMultipliers(std::size_t acquired);
+    double effectiveBoost(std::size_t booster, double multiplier) const;
+    StateVector boostGain(std::size_t booster, double ratio) const;
+    void checkpoint();
+    void countsChanged();
+    void updateSchedule();
+    double acquirableAfterCheckpoint(std::size_t index, double estimate) const;
+
+    const TechGraph *m_techGraph;
+    UnitStore m_units;
+    std::vector<double> m_boostMultipliers; // product of the effective factors of acquired boosters, per unit
+    std::vector<double> m_effectiveBoosts; // per booster, 1 for generators
+    // units whose multiplier needs refreshing, by UnitStore::boostRanks so
+    // that every unit is refreshed after the boosters targeting it
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> m_boostQueue;
+    std::vector<uint8_t> m_boostQueued;
+    StateVector m_state;
+    StateVector m_stateDelta;
+    StateVector m_checkpointState; // state right after the last purchase
+    double m_elapsedSinceCheckpoint = 0.0;
+
+    // For each unit, time since the last checkpoint at which it becomes
+    // acquirable. Only changes on purchases, so per-frame work is just
+    // popping the events that came due.
+    std::vector<double> m_acquirableAt;
+    struct AcquirableEvent {
+        double time;
+        std::size_t unit;
+        bool operator>(const AcquirableEvent &other) const { return time > other.time; }
+    };
+    std::priority_queue<AcquirableEvent, std::vector<AcquirableEvent>, std::greater<AcquirableEvent>> m_schedule;
+    std::size_t m_acquirableCount = 0;
+    SimulationEpochs m_epochs;
+};
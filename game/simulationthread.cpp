@@ -0,0 +1,166 @@
+#include "simulationthread.h"
+
+#include "savegame.h"
+
+SimulationThread::SimulationThread(const TechGraph *techGraph, double tickRate)
+    : m_techGraph(techGraph)
+    , m_simulation(techGraph)
+    , m_timestep(tickRate)
+    , m_commands(std::make_unique<SpscQueue<Command, 1024>>())
+{
+    publish();
+    m_snapshots.update();
+#ifndef __EMSCRIPTEN__
+    m_thread = std::thread(&SimulationThread::run, this);
+#endif
+}
+
+SimulationThread::~SimulationThread()
+{
+#ifndef __EMSCRIPTEN__
+    {
+        std::lock_guard lock(m_mutex);
+        m_done = true;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+#endif
+}
+
+void SimulationThread::update(double elapsed)
+{
+    const auto ticks = m_timestep.advance(elapsed);
+    if (ticks > 0) {
+        Command command;
+        command.type = Command::Type::Advance;
+        command.ticks = ticks;
+        submit(std::move(command));
+        m_ticksQueued += ticks;
+    }
+    if (m_synchronous)
+        wait();
+    else
+        m_snapshots.update();
+}
+
+double SimulationThread::lag() const
+{
+    return (m_ticksQueued - snapshot().tick) * m_timestep.tickInterval() + m_timestep.lag();
+}
+
+void SimulationThread::acquire(const Unit *unit, bool buyMax)
+{
+    Command command;
+    command.type = buyMax ? Command::Type::AcquireMax : Command::Type::Acquire;
+    command.unit = unit;
+    submit(std::move(command));
+}
+
+void SimulationThread::addEnergy(Real amount)
+{
+    Command command;
+    command.type = Command::Type::AddEnergy;
+    command.energy = amount;
+    submit(std::move(command));
+}
+
+void SimulationThread::reset()
+{
+    Command command;
+    command.type = Command::Type::Reset;
+    submit(std::move(command));
+    wait();
+}
+
+void SimulationThread::restore(const SaveGame &saveGame)
+{
+    Command command;
+    command.type = Command::Type::Restore;
+    command.saveGame = std::make_shared<SaveGame>(saveGame);
+    submit(std::move(command));
+    wait();
+}
+
+void SimulationThread::submit(Command command)
+{
+    ++m_commandsQueued;
+#ifdef __EMSCRIPTEN__
+    execute(command);
+    ++m_commandCount;
+    publish();
+    m_snapshots.update();
+#else
+    // only full if the simulation is hopelessly behind, let it catch up
+    while (!m_commands->push(std::move(command)))
+        std::this_thread::yield();
+    {
+        std::lock_guard lock(m_mutex);
+    }
+    m_condition.notify_one();
+#endif
+}
+
+void SimulationThread::wait()
+{
+    m_snapshots.update();
+    while (snapshot().commandCount < m_commandsQueued) {
+        std::this_thread::yield();
+        m_snapshots.update();
+    }
+}
+
+void SimulationThread::run()
+{
+#ifndef __EMSCRIPTEN__
+    while (true) {
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_done || !m_commands->empty(); });
+            if (m_done && m_commands->empty())
+                return;
+        }
+        // publish once per batch, the game thread only wants the latest state
+        while (auto command = m_commands->pop()) {
+            execute(*command);
+            ++m_commandCount;
+        }
+        publish();
+    }
+#endif
+}
+
+void SimulationThread::execute(const Command &command)
+{
+    switch (command.type) {
+    case Command::Type::Advance:
+        // tick by tick, the simulation must not depend on how ticks are batched
+        for (int i = 0; i < command.ticks; ++i)
+            m_simulation.update(m_timestep.tickInterval());
+        m_tick += command.ticks;
+        break;
+    case Command::Type::Acquire:
+        m_simulation.acquire(command.unit);
+        break;
+    case Command::Type::AcquireMax:
+        m_simulation.acquire(command.unit, m_simulation.maxAcquirable(command.unit));
+        break;
+    case Command::Type::AddEnergy:
+        m_simulation.addEnergy(command.energy);
+        break;
+    case Command::Type::Reset:
+        m_simulation.reset();
+        break;
+    case Command::Type::Restore:
+        m_simulation.restore(command.saveGame->counts, command.saveGame->state);
+        break;
+    }
+}
+
+void SimulationThread::publish()
+{
+    auto &snapshot = m_snapshots.back();
+    m_simulation.snapshot(snapshot);
+    snapshot.tick = m_tick;
+    snapshot.commandCount = m_commandCount;
+    m_snapshots.publish();
+}
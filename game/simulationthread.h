@@ -0,0 +1,97 @@
+#pragma once
+
+#include "fixedtimestep.h"
+#include "simulation.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct SaveGame;
+
+// Runs the Simulation on its own thread. The game thread sends it commands
+// (ticks, purchases, harvests) through a lock-free queue and reads the
+// latest published SimulationSnapshot from a triple buffer, so neither side
+// ever waits for the other. Ticks are commands like everything else, so the
+// simulation sees the same sequence of ticks and purchases however the
+// threads get scheduled. Without threads (emscripten) commands are executed
+// right away.
+class SimulationThread
+{
+public:
+    SimulationThread(const TechGraph *techGraph, double tickRate);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread &) = delete;
+    SimulationThread &operator=(const SimulationThread &) = delete;
+
+    const TechGraph *techGraph() const { return m_techGraph; }
+
+    // Queues the ticks due after elapsed seconds of frame time and picks up
+    // the latest snapshot.
+    void update(double elapsed);
+
+    const SimulationSnapshot &snapshot() const { return m_snapshots.front(); }
+    // How far the frame is ahead of the snapshot, in seconds.
+    double lag() const;
+
+    // Makes update() wait for the simulation to catch up, so that the
+    // snapshot always reflects every command sent so far. For recording and
+    // replaying sessions, where what the UI sees must not depend on timing.
+    void setSynchronous(bool synchronous) { m_synchronous = synchronous; }
+
+    void acquire(const Unit *unit, bool buyMax);
+    void addEnergy(Real amount);
+
+    // These wait for the simulation so the snapshot is current when they return.
+    void reset();
+    void restore(const SaveGame &saveGame); // counts in TechGraph::units order
+
+private:
+    struct Command {
+        enum class Type {
+            Advance,
+            Acquire,
+            AcquireMax,
+            AddEnergy,
+            Reset,
+            Restore,
+        };
+        Type type = Type::Advance;
+        const Unit *unit = nullptr;
+        int ticks = 0;
+        Real energy;
+        std::shared_ptr<const SaveGame> saveGame;
+    };
+
+    void submit(Command command);
+    void wait();
+    void run();
+    void execute(const Command &command);
+    void publish();
+
+    const TechGraph *m_techGraph;
+    Simulation m_simulation; // only touched by the simulation thread
+    FixedTimestep m_timestep;
+    uint64_t m_ticksQueued = 0;
+    uint64_t m_commandsQueued = 0;
+    bool m_synchronous = false;
+
+    // simulation thread state
+    uint64_t m_tick = 0;
+    uint64_t m_commandCount = 0;
+
+    TripleBuffer<SimulationSnapshot> m_snapshots;
+    std::unique_ptr<SpscQueue<Command, 1024>> m_commands;
+#ifndef __EMSCRIPTEN__
+    // only for sleeping while there's nothing to do
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::atomic<bool> m_done = false;
+    std::thread m_thread;
+#endif
+};
@@ -1,15 +1,70 @@
 #include "spritebatcher.h"
 #include "abstracttexture.h"
+#include "radixsort.h"
 #include "textureatlas.h"
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <vector>
 
 namespace GX {
 
+namespace {
+
+#ifdef SPRITE_PACKED_VERTICES
+constexpr GLenum GLTextureCoordsType = GL_UNSIGNED_SHORT;
+constexpr GLenum GLColorType = GL_UNSIGNED_BYTE;
+constexpr GLenum GLParametersType = GL_HALF_FLOAT;
+
+std::array<GLushort, 2> glTextureCoords(const glm::vec2 &v)
+{
+    return { glm::packUnorm1x16(v.x), glm::packUnorm1x16(v.y) };
+}
+
+std::array<GLubyte, 4> glColor(const glm::vec4 &v)
+{
+    return { glm::packUnorm1x8(v.x), glm::packUnorm1x8(v.y), glm::packUnorm1x8(v.z), glm::packUnorm1x8(v.w) };
+}
+
+std::array<GLushort, 4> glParameters(const glm::vec4 &v)
+{
+    return { glm::packHalf1x16(v.x), glm::packHalf1x16(v.y), glm::packHalf1x16(v.z), glm::packHalf1x16(v.w) };
+}
+#else
+constexpr GLenum GLTextureCoordsType = GL_FLOAT;
+constexpr GLenum GLColorType = GL_FLOAT;
+constexpr GLenum GLParametersType = GL_FLOAT;
+
+const glm::vec2 &glTextureCoords(const glm::vec2 &v)
+{
+    return v;
+}
+
+const glm::vec4 &glColor(const glm::vec4 &v)
+{
+    return v;
+}
+
+const glm::vec4 &glParameters(const glm::vec4 &v)
+{
+    return v;
+}
+#endif
+
+// integer types are normalized to [0, 1]
+void vertexAttribute(GLuint index, GLint size, GLenum type, GLsizei stride, std::size_t offset)
+{
+    const auto normalized = type == GL_UNSIGNED_BYTE || type == GL_UNSIGNED_SHORT ? GL_TRUE : GL_FALSE;
+    glVertexAttribPointer(index, size, type, normalized, stride, reinterpret_cast<const GLvoid *>(offset));
+}
+
+} // namespace
+
 SpriteBatcher::SpriteBatcher(GX::ShaderManager *shaderManager)
     : m_shaderManager(shaderManager)
 {
@@ -44,6 +99,7 @@ ShaderManager::Program SpriteBatcher::batchProgram() const
 void SpriteBatcher::startBatch()
 {
     m_quadCount = 0;
+    m_textures.clear();
 }
 
 void SpriteBatcher::addSprite(const PackedPixmap &pixmap, const glm::vec2 &topLeft, const glm::vec2 &bottomRight, const glm::vec4 &fgColor, const glm::vec4 &bgColor, const glm::vec4 &size, int depth)
@@ -105,16 +161,47 @@ void SpriteBatcher::addSprite(const PackedPixmap &pixmap, const glm::vec2 &topLe
 
 void SpriteBatcher::addSprite(const AbstractTexture *texture, const QuadVerts &verts, int depth)
 {
-    if (m_quadCount == MaxQuadsPerBatch) {
+    // a batch only uses a few textures (atlas pages), a linear search is fine
+    auto textureId = std::find(m_textures.begin(), m_textures.end(), texture) - m_textures.begin();
+    if (m_quadCount == MaxQuadsPerBatch || textureId == MaxTexturesPerBatch) {
         renderBatch();
         startBatch();
+        textureId = 0;
     }
+    if (textureId == static_cast<std::ptrdiff_t>(m_textures.size()))
+        m_textures.push_back(texture);
+
+    const auto sequence = m_quadCount++;
+    m_sortKeys[sequence] = sortKey(depth, m_batchProgram, textureId, sequence);
+
+    auto &quad = m_quads[sequence];
+#ifdef SPRITE_INSTANCING
+    const auto &v0 = verts[0];
+    quad = Instance {
+        v0.position,
+        glTextureCoords(v0.textureCoords),
+        glTextureCoords(verts[2].textureCoords),
+        glColor(v0.fgColor),
+        glColor(v0.bgColor),
+        glParameters(v0.size),
+        verts[1].position - v0.position,
+        verts[3].position - v0.position
+    };
+#else
+    std::transform(verts.begin(), verts.end(), quad.begin(), [](const Vertex &v) {
+        return GLVertex { v.position, glTextureCoords(v.textureCoords), glColor(v.fgColor), glColor(v.bgColor), glParameters(v.size) };
+    });
+#endif
+}
 
-    auto &quad = m_quads[m_quadCount++];
-    quad.texture = texture;
-    quad.program = m_batchProgram;
-    quad.verts = verts;
-    quad.depth = depth;
+uint64_t SpriteBatcher::sortKey(int depth, ShaderManager::Program program, std::size_t textureId, int sequence)
+{
+    constexpr auto DepthBias = 1 << (DepthBits - 1);
+    const auto biasedDepth = static_cast<uint64_t>(std::clamp(depth + DepthBias, 0, (1 << DepthBits) - 1));
+    return biasedDepth << (ProgramBits + TextureBits + SequenceBits)
+            | static_cast<uint64_t>(program) << (TextureBits + SequenceBits)
+            | static_cast<uint64_t>(textureId) << SequenceBits
+            | static_cast<uint64_t>(sequence);
 }
 
 void SpriteBatcher::renderBatch() const
@@ -122,15 +209,10 @@ void SpriteBatcher::renderBatch() const
     if (m_quadCount == 0)
         return;
 
-    static std::array<const Quad *, MaxQuadsPerBatch> sortedQuads;
-    const auto quadsEnd = m_quads.begin() + m_quadCount;
-    std::transform(m_quads.begin(), quadsEnd, sortedQuads.begin(), [](const Quad &quad) {
-        return &quad;
-    });
-    const auto sortedQuadsEnd = sortedQuads.begin() + m_quadCount;
-    std::stable_sort(sortedQuads.begin(), sortedQuadsEnd, [](const Quad *a, const Quad *b) {
-        return std::tie(a->depth, a->texture, a->program) < std::tie(b->depth, b->texture, b->program);
-    });
+    const auto start = std::chrono::steady_clock::now();
+
+    // keys are made in sequence order, the sort only has to order the bits above it
+    radixSort(m_sortKeys.data(), m_sortScratch.data(), m_quadCount, SequenceBits);
 
     glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
     glBindVertexArray(m_vao);
@@ -138,67 +220,46 @@ void SpriteBatcher::renderBatch() const
     const AbstractTexture *currentTexture = nullptr;
     std::optional<ShaderManager::Program> currentProgram = std::nullopt;
 
-    auto batchStart = sortedQuads.begin();
-    while (batchStart != sortedQuadsEnd) {
-        const auto *batchTexture = (*batchStart)->texture;
-        const auto batchProgram = (*batchStart)->program;
-        const auto batchEnd = std::find_if(batchStart + 1, sortedQuadsEnd, [batchTexture, batchProgram](const Quad *quad) {
-            return quad->texture != batchTexture || quad->program != batchProgram;
+    constexpr auto SequenceMask = (uint64_t(1) << SequenceBits) - 1;
+    constexpr auto BatchMask = (uint64_t(1) << (ProgramBits + TextureBits)) - 1; // above the sequence bits
+    const auto batchOf = [](uint64_t key) {
+        return (key >> SequenceBits) & BatchMask;
+    };
+
+    const auto sortKeysEnd = m_sortKeys.begin() + m_quadCount;
+    auto batchStart = m_sortKeys.begin();
+    while (batchStart != sortKeysEnd) {
+        const auto batch = batchOf(*batchStart);
+        const auto batchEnd = std::find_if(batchStart + 1, sortKeysEnd, [&batchOf, batch](uint64_t key) {
+            return batchOf(key) != batch;
         });
+        const auto *batchTexture = m_textures[batch & (MaxTexturesPerBatch - 1)];
+        const auto batchProgram = static_cast<ShaderManager::Program>(batch >> TextureBits);
 
         const auto quadCount = batchEnd - batchStart;
         const auto bufferRangeSize = quadCount * GLQuadSize;
 
-        if (!m_bufferAllocated || (m_bufferOffset + bufferRangeSize > BufferCapacity)) {
-            // orphan the old buffer and grab a new memory block
-            glBufferData(GL_ARRAY_BUFFER, BufferCapacity * sizeof(GLfloat), nullptr, GL_STREAM_DRAW);
-            m_bufferOffset = 0;
-            m_bufferAllocated = true;
+        const auto emit = [this, batchStart, batchEnd](GLQuad *data) {
+            std::transform(batchStart, batchEnd, data, [this](uint64_t key) {
+                return m_quads[key & SequenceMask];
+            });
+        };
+        if (m_ringData) {
+            if (m_bufferOffset + bufferRangeSize > (m_ringRegion + 1) * BufferSize)
+                nextRingRegion();
+            emit(reinterpret_cast<GLQuad *>(m_ringData + m_bufferOffset));
+        } else {
+            if (!m_bufferAllocated || (m_bufferOffset + bufferRangeSize > BufferSize)) {
+                // orphan the old buffer and grab a new memory block
+                glBufferData(GL_ARRAY_BUFFER, BufferSize, nullptr, GL_STREAM_DRAW);
+                m_bufferOffset = 0;
+                m_bufferAllocated = true;
+            }
+            emit(reinterpret_cast<GLQuad *>(glMapBufferRange(GL_ARRAY_BUFFER, m_bufferOffset, bufferRangeSize,
+                                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT)));
+            glUnmapBuffer(GL_ARRAY_BUFFER);
         }
 
-        auto *data = reinterpret_cast<GLfloat *>(glMapBufferRange(GL_ARRAY_BUFFER,
-                                                                  m_bufferOffset * sizeof(GLfloat),
-                                                                  bufferRangeSize * sizeof(GLfloat),
-                                                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
-        for (auto it = batchStart; it != batchEnd; ++it) {
-            auto *quadPtr = *it;
-
-            const auto &verts = quadPtr->verts;
-
-            const auto emitVertex = [&data, &verts](int index) {
-                const auto &v = verts[index];
-                *data++ = v.position.x;
-                *data++ = v.position.y;
-
-                *data++ = v.textureCoords.x;
-                *data++ = v.textureCoords.y;
-
-                *data++ = v.fgColor.x;
-                *data++ = v.fgColor.y;
-                *data++ = v.fgColor.z;
-                *data++ = v.fgColor.w;
-
-                *data++ = v.bgColor.x;
-                *data++ = v.bgColor.y;
-                *data++ = v.bgColor.z;
-                *data++ = v.bgColor.w;
-
-                *data++ = v.size.x;
-                *data++ = v.size.y;
-                *data++ = v.size.z;
-                *data++ = v.size.w;
-            };
-
-            emitVertex(0);
-            emitVertex(1);
-            emitVertex(2);
-
-            emitVertex(2);
-            emitVertex(3);
-            emitVertex(0);
-        }
-        glUnmapBuffer(GL_ARRAY_BUFFER);
-
         if (currentTexture != batchTexture) {
             currentTexture = batchTexture;
             if (currentTexture)
@@ -213,51 +274,143 @@ void SpriteBatcher::renderBatch() const
                 m_shaderManager->setUniform(ShaderManager::Uniform::BaseColorTexture, 0);
         }
 
-        glDrawArrays(GL_TRIANGLES, m_bufferOffset / GLVertexSize, quadCount * 6);
+#ifdef SPRITE_INSTANCING
+        setInstanceOffset(m_bufferOffset);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, quadCount);
+#else
+        // the indices count from the current ring region, so the batch starts
+        // at its first quad's indices rather than at a base vertex (which
+        // GLES 3 doesn't have)
+        const auto firstIndex = (m_bufferOffset - m_ringRegion * BufferSize) / GLQuadSize * 6;
+        glDrawElements(GL_TRIANGLES, quadCount * 6, GL_UNSIGNED_SHORT, reinterpret_cast<const GLvoid *>(firstIndex * sizeof(GLushort)));
+#endif
 
         m_bufferOffset += bufferRangeSize;
         batchStart = batchEnd;
+
+        m_statistics.quads += quadCount;
+        ++m_statistics.drawCalls;
+        m_statistics.bytesUploaded += bufferRangeSize;
     }
 
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_statistics.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SpriteBatcher::finishFrame()
+{
+    // skip to the next region with the next batch
+    if (m_ringData && m_bufferOffset != m_ringRegion * BufferSize)
+        m_bufferOffset = (m_ringRegion + 1) * BufferSize;
+}
+
+void SpriteBatcher::nextRingRegion() const
+{
+    m_ringFences[m_ringRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_ringRegion = (m_ringRegion + 1) % RingRegionCount;
+    m_bufferOffset = m_ringRegion * BufferSize;
+
+    if (auto &fence = m_ringFences[m_ringRegion]) {
+        constexpr GLuint64 Timeout = 1'000'000'000; // in nanoseconds
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, Timeout) == GL_TIMEOUT_EXPIRED)
+            spdlog::warn("Still waiting for the GPU to release a sprite buffer region");
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+#ifndef SPRITE_INSTANCING
+    setVertexOffset(m_bufferOffset);
+#endif
 }
 
 void SpriteBatcher::initializeResources()
 {
     glGenBuffers(1, &m_vbo);
+#ifndef SPRITE_INSTANCING
+    glGenBuffers(1, &m_ebo);
+#endif
     glGenVertexArrays(1, &m_vao);
 
     glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
     glBindVertexArray(m_vao);
 
-    // position
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid *>(offsetof(Vertex, position)));
-
-    // textureCoords
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid *>(offsetof(Vertex, textureCoords)));
-
-    // fgColor
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid *>(offsetof(Vertex, fgColor)));
+#ifndef __EMSCRIPTEN__
+    if (GLEW_ARB_buffer_storage) {
+        constexpr GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        constexpr auto RingSize = RingRegionCount * BufferSize;
+        glBufferStorage(GL_ARRAY_BUFFER, RingSize, nullptr, Flags);
+        m_ringData = reinterpret_cast<char *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, RingSize, Flags));
+        if (!m_ringData) {
+            // the storage is immutable, start over with a buffer to orphan
+            spdlog::warn("Failed to map the sprite buffer persistently");
+            glDeleteBuffers(1, &m_vbo);
+            glGenBuffers(1, &m_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        }
+    }
+#endif
 
-    // bgColor
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid *>(offsetof(Vertex, bgColor)));
+#ifdef SPRITE_INSTANCING
+    // origin, textureCoords0 + textureCoords2, fgColor, bgColor, size, edge1 + edge3
+    for (GLuint attribute = 0; attribute < 6; ++attribute) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+#else
+    // two triangles per quad, 0-1-2 and 2-3-0; the element buffer binding is
+    // part of the vertex array state
+    std::vector<GLushort> indices;
+    indices.reserve(MaxQuadsPerBatch * 6);
+    for (int i = 0; i < MaxQuadsPerBatch; ++i) {
+        for (const auto vertex : { 0, 1, 2, 2, 3, 0 })
+            indices.push_back(static_cast<GLushort>(4 * i + vertex));
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
 
-    // size
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid *>(offsetof(Vertex, size)));
+    // position, textureCoords, fgColor, bgColor, size
+    for (GLuint attribute = 0; attribute < 5; ++attribute)
+        glEnableVertexAttribArray(attribute);
+    setVertexOffset(0);
+#endif
 
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+#ifdef SPRITE_INSTANCING
+void SpriteBatcher::setInstanceOffset(int offset) const
+{
+    vertexAttribute(0, 2, GL_FLOAT, sizeof(Instance), offset + offsetof(Instance, origin));
+    vertexAttribute(1, 4, GLTextureCoordsType, sizeof(Instance), offset + offsetof(Instance, textureCoords0));
+    vertexAttribute(2, 4, GLColorType, sizeof(Instance), offset + offsetof(Instance, fgColor));
+    vertexAttribute(3, 4, GLColorType, sizeof(Instance), offset + offsetof(Instance, bgColor));
+    vertexAttribute(4, 4, GLParametersType, sizeof(Instance), offset + offsetof(Instance, size));
+    vertexAttribute(5, 4, GL_FLOAT, sizeof(Instance), offset + offsetof(Instance, edge1));
+}
+#else
+void SpriteBatcher::setVertexOffset(int offset) const
+{
+    vertexAttribute(0, 2, GL_FLOAT, sizeof(GLVertex), offset + offsetof(GLVertex, position));
+    vertexAttribute(1, 2, GLTextureCoordsType, sizeof(GLVertex), offset + offsetof(GLVertex, textureCoords));
+    vertexAttribute(2, 4, GLColorType, sizeof(GLVertex), offset + offsetof(GLVertex, fgColor));
+    vertexAttribute(3, 4, GLColorType, sizeof(GLVertex), offset + offsetof(GLVertex, bgColor));
+    vertexAttribute(4, 4, GLParametersType, sizeof(GLVertex), offset + offsetof(GLVertex, size));
+}
+#endif
+
 void SpriteBatcher::releaseResources()
 {
+    for (auto fence : m_ringFences) {
+        if (fence)
+            glDeleteSync(fence);
+    }
     glDeleteBuffers(1, &m_vbo);
+#ifndef SPRITE_INSTANCING
+    glDeleteBuffers(1, &m_ebo);
+#endif
     glDeleteVertexArrays(1, &m_vao);
 }
 
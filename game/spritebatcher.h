@@ -7,7 +7,10 @@
 #include <GL/glew.h>
 #include <glm/vec2.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#include <vector>
 
 namespace GX {
 
@@ -42,32 +45,124 @@ public:
     void addSprite(const PackedPixmap &pixmap, const glm::vec2 &topLeft, const glm::vec2 &bottomRight, const glm::vec4 &fgColor, const glm::vec4 &bgColor, const glm::vec4 &size, int depth);
     void addSprite(const AbstractTexture *texture, const QuadVerts &verts, int depth);
     void renderBatch() const;
+    // Call once the frame's batches are rendered, lets the GPU catch up on
+    // the streaming buffer a frame at a time.
+    void finishFrame();
+
+    // Totals over every renderBatch call since the last reset, for comparing
+    // rendering paths (see --replay).
+    struct Statistics {
+        uint64_t quads = 0;
+        uint64_t drawCalls = 0;
+        uint64_t bytesUploaded = 0;
+        double seconds = 0.0; // CPU time spent in renderBatch
+    };
+    const Statistics &statistics() const { return m_statistics; }
+    void resetStatistics() { m_statistics = {}; }
 
 private:
     void initializeResources();
     void releaseResources();
-
-    struct Quad {
-        const AbstractTexture *texture;
-        ShaderManager::Program program;
-        QuadVerts verts;
-        int depth;
+    static uint64_t sortKey(int depth, ShaderManager::Program program, std::size_t textureId, int sequence);
+#ifdef SPRITE_INSTANCING
+    // GLES 3 can't draw from a base instance, so the instance attributes
+    // are pointed at each batch instead
+    void setInstanceOffset(int offset) const; // in bytes
+#else
+    // the quad indices start at the vertices of the current ring region
+    void setVertexOffset(int offset) const; // in bytes
+#endif
+    void nextRingRegion() const;
+
+#ifdef SPRITE_PACKED_VERTICES
+    // Colors as normalized RGBA8, texture coordinates as normalized 16 bit
+    // integers and shader parameters as half floats. The GL expands them on
+    // fetch, so the shaders see the same vec4s as with plain floats.
+    using GLTextureCoords = std::array<GLushort, 2>;
+    using GLColor = std::array<GLubyte, 4>;
+    using GLParameters = std::array<GLushort, 4>;
+#else
+    using GLTextureCoords = glm::vec2;
+    using GLColor = glm::vec4;
+    using GLParameters = glm::vec4;
+#endif
+
+#ifdef SPRITE_INSTANCING
+    // Everything the vertex shader needs to derive the four vertices of a
+    // quad, uploaded once per quad. Only parallelograms fit, which is all
+    // that gets drawn: corner 2 is corner 1 + corner 3 - corner 0, and the
+    // texture coordinates are a rectangle.
+    struct Instance {
+        glm::vec2 origin; // corner 0
+        GLTextureCoords textureCoords0; // of corner 0
+        GLTextureCoords textureCoords2; // of corner 2
+        GLColor fgColor;
+        GLColor bgColor;
+        GLParameters size;
+        glm::vec2 edge1; // corner 1 - corner 0
+        glm::vec2 edge3; // corner 3 - corner 0
     };
-
-    static constexpr int BufferCapacity = 0x100000; // in floats
-    static constexpr int GLVertexSize = sizeof(Vertex) / sizeof(GLfloat); // in floats
-    static constexpr int GLQuadSize = 6 * GLVertexSize; // 6 verts per quad
-    static constexpr int MaxQuadsPerBatch = BufferCapacity / GLQuadSize;
+    using GLQuad = Instance;
+#else
+    struct GLVertex {
+        glm::vec2 position;
+        GLTextureCoords textureCoords;
+        GLColor fgColor;
+        GLColor bgColor;
+        GLParameters size;
+    };
+    using GLQuad = std::array<GLVertex, 4>;
+#endif
+
+    static constexpr int MaxBufferSize = 0x400000; // in bytes
+    static constexpr int GLQuadSize = sizeof(GLQuad); // in bytes
+#ifdef SPRITE_INSTANCING
+    static constexpr int MaxQuadsPerBatch = MaxBufferSize / GLQuadSize;
+#else
+    // quad indices must fit in GLushort
+    static constexpr int MaxQuadsPerBatch = std::min(MaxBufferSize / GLQuadSize, 0x10000 / 4);
+#endif
+    static constexpr int BufferSize = MaxQuadsPerBatch * GLQuadSize; // in bytes
+
+    // With ARB_buffer_storage the vertex buffer is a ring of regions that
+    // stays mapped, a region per frame (or per buffer full). Leaving a region
+    // fences it, and it's only written again once the GPU passed the fence.
+    // Without it, the buffer is orphaned whenever it fills.
+    static constexpr int RingRegionCount = 3;
+
+    // Quads are drawn by depth, then program, then texture, then in the
+    // order they were added. All of that is packed into one 64 bit key per
+    // quad, so that sorting is a radix sort over plain integers and batches
+    // are runs of keys with the same program and texture bits. From the
+    // lowest bits up: sequence, texture id, program, biased depth.
+    static constexpr int SequenceBits = 20;
+    static constexpr int TextureBits = 12;
+    static constexpr int ProgramBits = 8;
+    static constexpr int DepthBits = 24;
+    static constexpr int MaxTexturesPerBatch = 1 << TextureBits;
+    static_assert(MaxQuadsPerBatch <= 1 << SequenceBits, "quad index must fit in the sort key");
+    static_assert(ShaderManager::NumPrograms <= 1 << ProgramBits, "program must fit in the sort key");
+    static_assert(SequenceBits + TextureBits + ProgramBits + DepthBits == 64, "sort key must fill 64 bits");
 
     GX::ShaderManager *m_shaderManager;
-    std::array<Quad, MaxQuadsPerBatch> m_quads;
+    std::array<GLQuad, MaxQuadsPerBatch> m_quads; // as uploaded
+    mutable std::array<uint64_t, MaxQuadsPerBatch> m_sortKeys;
+    mutable std::array<uint64_t, MaxQuadsPerBatch> m_sortScratch;
     int m_quadCount = 0;
+    std::vector<const AbstractTexture *> m_textures; // of the current batch, by texture id
     GLuint m_vao;
     GLuint m_vbo;
+#ifndef SPRITE_INSTANCING
+    GLuint m_ebo; // indices of every quad that fits in the vertex buffer, never changes
+#endif
     glm::mat4 m_transformMatrix;
     ShaderManager::Program m_batchProgram = ShaderManager::Program::Text;
     mutable bool m_bufferAllocated = false;
-    mutable int m_bufferOffset = 0;
+    mutable int m_bufferOffset = 0; // in bytes
+    char *m_ringData = nullptr; // persistently mapped, null when orphaning
+    mutable int m_ringRegion = 0;
+    mutable std::array<GLsync, RingRegionCount> m_ringFences = {};
+    mutable Statistics m_statistics;
 };
 
 } // namespace GX
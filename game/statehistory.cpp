@@ -0,0 +1,157 @@
+#include "statehistory.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+// a bit more than the last minute, hour and day
+constexpr std::array<std::size_t, StateHistory::ResolutionCount> Capacities = { 120, 120, 48 };
+// seconds per minute, minutes per hour
+constexpr std::size_t Fanout = 60;
+
+StateVector componentMin(const StateVector &lhs, const StateVector &rhs)
+{
+    return { std::min(lhs.extropy, rhs.extropy), std::min(lhs.energy, rhs.energy), std::min(lhs.material, rhs.material), std::min(lhs.carbon, rhs.carbon) };
+}
+
+StateVector componentMax(const StateVector &lhs, const StateVector &rhs)
+{
+    return { std::max(lhs.extropy, rhs.extropy), std::max(lhs.energy, rhs.energy), std::max(lhs.material, rhs.material), std::max(lhs.carbon, rhs.carbon) };
+}
+
+void merge(StateHistorySample::Range &range, const StateHistorySample::Range &other, double weight, bool first)
+{
+    range.min = first ? other.min : componentMin(range.min, other.min);
+    range.max = first ? other.max : componentMax(range.max, other.max);
+    range.mean += weight * other.mean;
+}
+} // namespace
+
+StateHistory::StateHistory()
+{
+    for (std::size_t i = 0; i < ResolutionCount; ++i)
+        m_levels[i].samples.resize(Capacities[i]);
+}
+
+void StateHistory::append(double elapsed, const StateVector &state, const StateVector &delta)
+{
+    StateHistorySample sample;
+    sample.state = { state, state, state };
+    sample.delta = { delta, delta, delta };
+    auto &pending = m_levels[0].pending;
+
+    if (m_elapsed + elapsed < 1.0) {
+        sample.duration = elapsed;
+        pending.add(sample);
+        m_elapsed += elapsed;
+        return;
+    }
+
+    // the frame completes the current second and covers every whole second
+    // after it, then starts the next one
+    sample.duration = 1.0 - m_elapsed;
+    pending.add(sample);
+    complete(0);
+
+    const auto remaining = elapsed - sample.duration;
+    const auto wholeSeconds = std::floor(remaining);
+    if (wholeSeconds > 0.0) {
+        sample.duration = 1.0;
+        store(0, sample, static_cast<std::size_t>(wholeSeconds));
+    }
+
+    m_elapsed = remaining - wholeSeconds;
+    if (m_elapsed > 0.0) {
+        sample.duration = m_elapsed;
+        pending.add(sample);
+    }
+}
+
+void StateHistory::complete(std::size_t level)
+{
+    auto &current = m_levels[level];
+    const auto sample = current.pending.finish();
+    current.pending = {};
+    store(level, sample, 1);
+}
+
+// Stores repeat copies of a completed sample and accumulates them into the
+// level above. Only the last capacity copies can be kept anyway.
+void StateHistory::store(std::size_t level, const StateHistorySample &sample, std::size_t repeat)
+{
+    auto &current = m_levels[level];
+    const auto capacity = current.samples.size();
+    for (std::size_t i = 0, stored = std::min(repeat, capacity); i < stored; ++i) {
+        current.samples[current.head] = sample;
+        current.head = (current.head + 1) % capacity;
+    }
+    current.size = std::min(current.size + repeat, capacity);
+
+    if (level + 1 < ResolutionCount) {
+        auto &next = m_levels[level + 1].pending;
+        while (repeat > 0) {
+            const auto added = std::min(repeat, Fanout - next.children);
+            next.add(sample, added);
+            next.children += added;
+            repeat -= added;
+            if (next.children == Fanout)
+                complete(level + 1);
+        }
+    }
+}
+
+void StateHistory::clear()
+{
+    for (auto &level : m_levels) {
+        level.head = 0;
+        level.size = 0;
+        level.pending = {};
+    }
+    m_elapsed = 0.0;
+}
+
+const StateHistorySample &StateHistory::sample(Resolution resolution, std::size_t index) const
+{
+    const auto &level = m_levels[static_cast<std::size_t>(resolution)];
+    assert(index < level.size);
+    const auto capacity = level.samples.size();
+    return level.samples[(level.head + capacity - level.size + index) % capacity];
+}
+
+double StateHistory::interval(Resolution resolution)
+{
+    return std::pow(Fanout, static_cast<int>(resolution));
+}
+
+std::size_t StateHistory::capacity(Resolution resolution)
+{
+    return Capacities[static_cast<std::size_t>(resolution)];
+}
+
+void StateHistory::Accumulator::add(const StateHistorySample &sample, std::size_t repeat)
+{
+    const auto weight = static_cast<double>(repeat) * sample.duration;
+    merge(state, sample.state, weight, count == 0);
+    merge(delta, sample.delta, weight, count == 0);
+    count += repeat;
+    duration += weight;
+}
+
+StateHistorySample StateHistory::Accumulator::finish() const
+{
+    StateHistorySample sample;
+    sample.state = state;
+    sample.delta = delta;
+    sample.duration = duration;
+    if (duration > 0.0) {
+        const auto scale = 1.0 / duration;
+        sample.state.mean *= scale;
+        sample.delta.mean *= scale;
+    } else {
+        // only zero-length appends, nothing to weight them by
+        sample.state.mean = state.min;
+        sample.delta.mean = delta.min;
+    }
+    return sample;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "techgraph.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Per-component minimum, maximum and time-weighted mean of the state and its
+// rate of change over some stretch of time.
+struct StateHistorySample {
+    struct Range {
+        StateVector min;
+        StateVector max;
+        StateVector mean;
+    };
+    Range state;
+    Range delta;
+    double duration = 0.0; // in seconds
+};
+
+// Fixed-memory history of the state for charting, at a few resolutions.
+// Appends accumulate into the current second; every completed second is
+// stored and accumulated into the current minute, every completed minute
+// into the current hour. Each append counts for the time since the previous
+// one; a frame longer than what's left of the second completes the second
+// and repeats its state for every whole second after it, so the time axis
+// stays wall time across stalls. Each resolution keeps its latest samples in
+// a ring buffer, so memory stays the same however long the game runs.
+class StateHistory
+{
+public:
+    enum class Resolution {
+        Second,
+        Minute,
+        Hour,
+    };
+    static constexpr std::size_t ResolutionCount = 3;
+
+    StateHistory();
+
+    // The state and its rate of change elapsed seconds after the last append.
+    void append(double elapsed, const StateVector &state, const StateVector &delta);
+    void clear();
+
+    // Completed samples, sample(resolution, 0) being the oldest.
+    std::size_t size(Resolution resolution) const { return m_levels[static_cast<std::size_t>(resolution)].size; }
+    const StateHistorySample &sample(Resolution resolution, std::size_t index) const;
+    static double interval(Resolution resolution);
+    static std::size_t capacity(Resolution resolution);
+
+private:
+    // the means hold time-weighted sums until the sample is finished
+    struct Accumulator {
+        StateHistorySample::Range state;
+        StateHistorySample::Range delta;
+        std::size_t count = 0; // samples added
+        double duration = 0.0;
+        std::size_t children = 0; // samples of the level below
+
+        void add(const StateHistorySample &sample, std::size_t repeat = 1);
+        StateHistorySample finish() const;
+    };
+
+    struct Level {
+        std::vector<StateHistorySample> samples;
+        std::size_t head = 0; // where the next sample goes
+        std::size_t size = 0;
+        Accumulator pending;
+    };
+
+    void complete(std::size_t level);
+    void store(std::size_t level, const StateHistorySample &sample, std::size_t repeat);
+
+    std::array<Level, ResolutionCount> m_levels;
+    double m_elapsed = 0.0; // in the current second
+};
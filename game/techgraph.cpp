@@ -1,10 +1,14 @@
 #include "techgraph.h"
 
+#include <algorithm>
 #include <codecvt>
-#include <ioutil.h>
+#include <fstream>
 #include <locale>
 
 #include <rapidjson/document.h>
+#include <rapidjson/istreamwrapper.h>
+#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/writer.h>
 #include <spdlog/spdlog.h>
 
 using namespace std::string_literals;
@@ -16,35 +20,70 @@ std::u32string utf8ToUtf32(const std::string &s)
     return cv.from_bytes(s.data());
 }
 
+std::string utf32ToUtf8(const std::u32string &s)
+{
+    static std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> cv;
+    return cv.to_bytes(s);
+}
+
 StateVector loadStateVector(const rapidjson::Value &value)
 {
     return {
-        value["extropy"].GetDouble(),
-        value["energy"].GetDouble(),
-        value["material"].GetDouble(),
-        value["carbon"].GetDouble()
+        Real(value["extropy"].GetDouble()),
+        Real(value["energy"].GetDouble()),
+        Real(value["material"].GetDouble()),
+        Real(value["carbon"].GetDouble())
     };
 }
+template<typename Writer>
+void saveStateVector(Writer &writer, const StateVector &value)
+{
+    writer.StartObject();
+    writer.Key("carbon");
+    writer.Double(static_cast<double>(value.carbon));
+    writer.Key("energy");
+    writer.Double(static_cast<double>(value.energy));
+    writer.Key("extropy");
+    writer.Double(static_cast<double>(value.extropy));
+    writer.Key("material");
+    writer.Double(static_cast<double>(value.material));
+    writer.EndObject();
+}
+void addBoostTarget(Unit *booster, const Unit *target)
+{
+    auto &targets = booster->boost.targets;
+    if (std::find(targets.begin(), targets.end(), target) == targets.end())
+        targets.push_back(target);
+}
 } // namespace
 
 bool TechGraph::load(const std::string &jsonPath)
 {
     units.clear();
+    costGrowth = CostGrowth;
 
-    auto json = GX::Util::readFile(jsonPath);
-    if (!json) {
+    std::ifstream file(jsonPath);
+    if (!file.is_open()) {
         spdlog::warn("Failed to read graph file {}", jsonPath);
         return false;
     }
-    json->push_back('\0');
 
+    rapidjson::IStreamWrapper stream(file);
     rapidjson::Document document;
-    rapidjson::ParseResult ok = document.Parse(reinterpret_cast<const char *>(json->data()));
-    if (!ok) {
-        spdlog::warn("Failed to parse graph file {}, error: {}, offset: {}", jsonPath, ok.Code(), ok.Offset());
+    document.ParseStream(stream);
+    if (document.HasParseError()) {
+        spdlog::warn("Failed to parse graph file {}, error: {}, offset: {}", jsonPath, document.GetParseError(), document.GetErrorOffset());
         return false;
     }
 
+    if (document.HasMember("costGrowth")) {
+        costGrowth = document["costGrowth"].GetDouble();
+        if (!(costGrowth > 1.0)) {
+            spdlog::warn("Invalid cost growth {} in graph file {}, using {}", costGrowth, jsonPath, CostGrowth);
+            costGrowth = CostGrowth;
+        }
+    }
+
     const auto &unitsArray = document["units"];
     assert(unitsArray.IsArray());
 
@@ -53,9 +92,13 @@ bool TechGraph::load(const std::string &jsonPath)
     units.reserve(unitsCount);
     std::generate_n(std::back_inserter(units), unitsCount, [] { return std::make_unique<Unit>(); });
 
+    std::vector<std::pair<Unit *, std::string>> targetCategories;
+
     for (size_t i = 0; i < unitsCount; ++i) {
         const auto &unitSettings = unitsArray[i];
         auto &unit = units[i];
+        unit->index = i;
+        unit->sourceIndex = i;
         unit->name = utf8ToUtf32(unitSettings["name"].GetString());
         unit->description = utf8ToUtf32(unitSettings["description"].GetString());
         unit->type = [type = unitSettings["type"].GetString()] {
@@ -66,27 +109,246 @@ bool TechGraph::load(const std::string &jsonPath)
         unit->position = glm::vec2(positionArray[0].GetDouble(), positionArray[1].GetDouble());
         unit->baseCost = loadStateVector(unitSettings["cost"]);
         unit->yield = loadStateVector(unitSettings["yield"]);
-        unit->boost = [this, &unitSettings] {
-            const rapidjson::Value &boost = unitSettings["boost"];
-            const auto factor = boost["factor"].GetDouble();
-            const auto targetIndex = boost["target"].GetInt();
-            const Unit *target = targetIndex >= 0 && targetIndex < units.size() ? units[targetIndex].get() : nullptr;
-            return Boost { factor, target };
-        }();
+        if (unitSettings.HasMember("category"))
+            unit->category = unitSettings["category"].GetString();
+        const auto &boost = unitSettings["boost"];
+        unit->boost.factor = boost["factor"].GetDouble();
+        // generators don't boost anything whatever their targets say
+        if (unit->type == Unit::Type::Booster) {
+            const auto addTarget = [&](int targetIndex) {
+                if (targetIndex < -1 || targetIndex >= static_cast<int>(unitsCount)) {
+                    spdlog::warn("Invalid boost target {} of unit {} in graph file {}", targetIndex, i, jsonPath);
+                    return false;
+                }
+                if (targetIndex >= 0)
+                    addBoostTarget(unit.get(), units[targetIndex].get());
+                return true;
+            };
+            // "target" is the single target of older graph files, -1 if none
+            if (boost.HasMember("target") && !addTarget(boost["target"].GetInt()))
+                return false;
+            if (boost.HasMember("targets")) {
+                const auto &targetsArray = boost["targets"];
+                assert(targetsArray.IsArray());
+                for (const auto &value : targetsArray.GetArray()) {
+                    if (!addTarget(value.GetInt()))
+                        return false;
+                }
+            }
+            if (boost.HasMember("categories")) {
+                const auto &categoriesArray = boost["categories"];
+                assert(categoriesArray.IsArray());
+                for (const auto &value : categoriesArray.GetArray())
+                    targetCategories.emplace_back(unit.get(), value.GetString());
+            }
+        }
         const auto &dependenciesArray = unitSettings["dependencies"];
         assert(dependenciesArray.IsArray());
         for (const auto &value : dependenciesArray.GetArray()) {
             const auto index = value.GetInt();
-            assert(index >= 0 && index < units.size());
+            if (index < 0 || index >= static_cast<int>(unitsCount)) {
+                spdlog::warn("Invalid dependency {} of unit {} in graph file {}", index, i, jsonPath);
+                return false;
+            }
             unit->dependencies.push_back(units[index].get());
         }
     }
 
+    // categories can only be resolved once every unit is loaded
+    for (const auto &[booster, category] : targetCategories) {
+        const auto count = booster->boost.targets.size();
+        for (const auto &unit : units) {
+            if (unit->category == category && unit.get() != booster)
+                addBoostTarget(booster, unit.get());
+        }
+        if (booster->boost.targets.size() == count)
+            spdlog::warn("No units in category {} boosted by unit {} in graph file {}", category, booster->sourceIndex, jsonPath);
+    }
+
+    if (!compile()) {
+        spdlog::warn("Invalid tech graph in graph file {}", jsonPath);
+        return false;
+    }
     return true;
 }
 
-void TechGraph::reset()
+bool TechGraph::compile()
 {
-    for (auto &unit : units)
-        unit->count = 0;
+    const auto unitCount = units.size();
+    const auto belongs = [this, unitCount](const Unit *unit) {
+        return unit && unit->index < unitCount && units[unit->index].get() == unit;
+    };
+
+    std::vector<uint32_t> missingDependencies(unitCount);
+    std::vector<uint32_t> successorOffsets(unitCount + 1, 0);
+    std::vector<std::size_t> lastBooster(unitCount, 0); // 1 + index of the last booster seen targeting the unit
+    std::vector<uint32_t> boostingBoosters(unitCount, 0); // boosters targeting the unit, if it's a booster itself
+    for (std::size_t i = 0; i < unitCount; ++i) {
+        const auto &unit = units[i];
+        if (unit->index != i) {
+            spdlog::warn("Unit {} has index {}", i, unit->index);
+            return false;
+        }
+        if (unit->type == Unit::Type::Booster) {
+            if (!(unit->boost.factor > 0.0)) {
+                spdlog::warn("Invalid boost factor {} of unit {}", unit->boost.factor, utf32ToUtf8(unit->name));
+                return false;
+            }
+        } else if (!unit->boost.targets.empty()) {
+            spdlog::warn("Generator {} has boost targets", utf32ToUtf8(unit->name));
+            return false;
+        }
+        // boosters without targets are allowed, they just do nothing
+        for (const auto *target : unit->boost.targets) {
+            if (!belongs(target) || target == unit.get()) {
+                spdlog::warn("Unit {} has a boost target outside the graph or boosts itself", utf32ToUtf8(unit->name));
+                return false;
+            }
+            if (lastBooster[target->index] == i + 1) {
+                spdlog::warn("Unit {} boosts {} twice", utf32ToUtf8(unit->name), utf32ToUtf8(target->name));
+                return false;
+            }
+            lastBooster[target->index] = i + 1;
+            if (target->type == Unit::Type::Booster)
+                ++boostingBoosters[target->index];
+        }
+        for (const auto *dependency : unit->dependencies) {
+            if (!belongs(dependency)) {
+                spdlog::warn("Unit {} has a dependency outside the graph", utf32ToUtf8(unit->name));
+                return false;
+            }
+            ++successorOffsets[dependency->index + 1];
+        }
+        missingDependencies[i] = unit->dependencies.size();
+    }
+    for (std::size_t i = 0; i < unitCount; ++i)
+        successorOffsets[i + 1] += successorOffsets[i];
+    std::vector<uint32_t> successors(successorOffsets.back());
+    auto next = successorOffsets;
+    for (const auto &unit : units) {
+        for (const auto *dependency : unit->dependencies)
+            successors[next[dependency->index]++] = unit->index;
+    }
+
+    // Kahn's algorithm a level at a time: a unit becomes ready in the level
+    // after its deepest dependency
+    std::vector<uint32_t> order;
+    order.reserve(unitCount);
+    for (std::size_t i = 0; i < unitCount; ++i) {
+        if (missingDependencies[i] == 0)
+            order.push_back(i);
+    }
+    std::vector<std::size_t> offsets { 0 };
+    for (std::size_t level = 0; order.size() > offsets.back(); ++level) {
+        const auto begin = offsets.back();
+        const auto end = order.size();
+        offsets.push_back(end);
+        std::sort(order.begin() + begin, order.end());
+        for (auto i = begin; i < end; ++i) {
+            units[order[i]]->level = level;
+            for (auto j = successorOffsets[order[i]]; j < successorOffsets[order[i] + 1]; ++j) {
+                if (--missingDependencies[successors[j]] == 0)
+                    order.push_back(successors[j]);
+            }
+        }
+    }
+    if (order.size() < unitCount) {
+        const auto cyclic = std::find_if(missingDependencies.begin(), missingDependencies.end(), [](uint32_t missing) { return missing > 0; });
+        spdlog::warn("Dependency cycle through unit {}", utf32ToUtf8(units[cyclic - missingDependencies.begin()]->name));
+        return false;
+    }
+
+    // boosters boosting boosters must not go round in circles either, or
+    // their effect would be unbounded
+    std::vector<uint32_t> ready;
+    for (std::size_t i = 0; i < unitCount; ++i) {
+        if (units[i]->type == Unit::Type::Booster && boostingBoosters[i] == 0)
+            ready.push_back(i);
+    }
+    for (std::size_t i = 0; i < ready.size(); ++i) {
+        for (const auto *target : units[ready[i]]->boost.targets) {
+            if (target->type == Unit::Type::Booster && --boostingBoosters[target->index] == 0)
+                ready.push_back(target->index);
+        }
+    }
+    const auto cyclic = std::find_if(boostingBoosters.begin(), boostingBoosters.end(), [](uint32_t missing) { return missing > 0; });
+    if (cyclic != boostingBoosters.end()) {
+        spdlog::warn("Boost cycle through unit {}", utf32ToUtf8(units[cyclic - boostingBoosters.begin()]->name));
+        return false;
+    }
+
+    std::vector<std::unique_ptr<Unit>> sorted;
+    sorted.reserve(unitCount);
+    for (const auto index : order) {
+        units[index]->index = sorted.size();
+        sorted.push_back(std::move(units[index]));
+    }
+    units = std::move(sorted);
+    levelOffsets = std::move(offsets);
+    return true;
+}
+
+bool TechGraph::save(const std::string &jsonPath) const
+{
+    std::ofstream file(jsonPath);
+    if (!file.is_open()) {
+        spdlog::warn("Failed to write graph file {}", jsonPath);
+        return false;
+    }
+
+    rapidjson::OStreamWrapper stream(file);
+    rapidjson::Writer<rapidjson::OStreamWrapper> writer(stream);
+    writer.StartObject();
+    if (costGrowth != CostGrowth) {
+        writer.Key("costGrowth");
+        writer.Double(costGrowth);
+    }
+    writer.Key("units");
+    writer.StartArray();
+    for (const auto &unit : units) {
+        writer.StartObject();
+        writer.Key("boost");
+        writer.StartObject();
+        writer.Key("factor");
+        writer.Double(unit->boost.factor);
+        writer.Key("targets");
+        writer.StartArray();
+        for (const auto *target : unit->boost.targets)
+            writer.Int(static_cast<int>(target->index));
+        writer.EndArray();
+        writer.EndObject();
+        if (!unit->category.empty()) {
+            writer.Key("category");
+            writer.String(unit->category.c_str());
+        }
+        writer.Key("cost");
+        saveStateVector(writer, unit->baseCost);
+        writer.Key("dependencies");
+        writer.StartArray();
+        for (const auto *dependency : unit->dependencies)
+            writer.Int(static_cast<int>(dependency->index));
+        writer.EndArray();
+        writer.Key("description");
+        writer.String(utf32ToUtf8(unit->description).c_str());
+        writer.Key("name");
+        writer.String(utf32ToUtf8(unit->name).c_str());
+        writer.Key("position");
+        writer.StartArray();
+        writer.Double(unit->position.x);
+        writer.Double(unit->position.y);
+        writer.EndArray();
+        writer.Key("type");
+        writer.String(unit->type == Unit::Type::Booster ? "Booster" : "Generator");
+        writer.Key("yield");
+        saveStateVector(writer, unit->yield);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    if (!file) {
+        spdlog::warn("Failed to write graph file {}", jsonPath);
+        return false;
+    }
+    return true;
 }
@@ -1,20 +1,37 @@
 #pragma once
 
+#include "bigreal.h"
+
+#include <cmath>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+// Type of resource amounts, picked by the REAL build option. BigReal never
+// runs out of range; the plain floating point types are there to compare
+// speed and accuracy against (see tools/realbench).
+#if defined(REAL_FLOAT)
+using Real = float;
+#elif defined(REAL_DOUBLE)
+using Real = double;
+#elif defined(REAL_LONG_DOUBLE)
 using Real = long double;
+#else
+using Real = BigReal;
+#endif
+
+template<typename T>
+struct BasicStateVector {
+    using value_type = T;
 
-struct StateVector {
-    Real extropy = 0.0;
-    Real energy = 0.0;
-    Real material = 0.0;
-    Real carbon = 0.0;
+    T extropy = 0.0;
+    T energy = 0.0;
+    T material = 0.0;
+    T carbon = 0.0;
 
-    StateVector &operator+=(const StateVector &other)
+    BasicStateVector &operator+=(const BasicStateVector &other)
     {
         extropy += other.extropy;
         energy += other.energy;
@@ -23,7 +40,7 @@ struct StateVector {
         return *this;
     }
 
-    StateVector &operator-=(const StateVector &other)
+    BasicStateVector &operator-=(const BasicStateVector &other)
     {
         extropy -= other.extropy;
         energy -= other.energy;
@@ -32,7 +49,7 @@ struct StateVector {
         return *this;
     }
 
-    StateVector &operator*=(const StateVector &other)
+    BasicStateVector &operator*=(const BasicStateVector &other)
     {
         extropy *= other.extropy;
         energy *= other.energy;
@@ -41,7 +58,7 @@ struct StateVector {
         return *this;
     }
 
-    StateVector &operator*=(Real factor)
+    BasicStateVector &operator*=(T factor)
     {
         extropy *= factor;
         energy *= factor;
@@ -51,36 +68,52 @@ struct StateVector {
     }
 };
 
-inline StateVector operator+(const StateVector &lhs, const StateVector &rhs)
+template<typename T>
+inline BasicStateVector<T> operator+(const BasicStateVector<T> &lhs, const BasicStateVector<T> &rhs)
 {
     return { lhs.extropy + rhs.extropy, lhs.energy + rhs.energy, lhs.material + rhs.material, lhs.carbon + rhs.carbon };
 }
 
-inline StateVector operator-(const StateVector &lhs, const StateVector &rhs)
+template<typename T>
+inline BasicStateVector<T> operator-(const BasicStateVector<T> &lhs, const BasicStateVector<T> &rhs)
 {
     return { lhs.extropy - rhs.extropy, lhs.energy - rhs.energy, lhs.material - rhs.material, lhs.carbon - rhs.carbon };
 }
 
-inline StateVector operator*(const StateVector &lhs, const StateVector &rhs)
+template<typename T>
+inline BasicStateVector<T> operator*(const BasicStateVector<T> &lhs, const BasicStateVector<T> &rhs)
 {
     return { lhs.extropy * rhs.extropy, lhs.energy * rhs.energy, lhs.material * rhs.material, lhs.carbon * rhs.carbon };
 }
 
-inline StateVector operator*(Real factor, const StateVector &rhs)
+// the factor isn't deduced, so that e.g. a double can scale a BigReal vector
+template<typename T>
+inline BasicStateVector<T> operator*(typename BasicStateVector<T>::value_type factor, const BasicStateVector<T> &rhs)
 {
     return { factor * rhs.extropy, factor * rhs.energy, factor * rhs.material, factor * rhs.carbon };
 }
 
-inline StateVector operator*(const StateVector &lhs, Real factor)
+template<typename T>
+inline BasicStateVector<T> operator*(const BasicStateVector<T> &lhs, typename BasicStateVector<T>::value_type factor)
 {
     return { lhs.extropy * factor, lhs.energy * factor, lhs.material * factor, lhs.carbon * factor };
 }
 
+using StateVector = BasicStateVector<Real>;
+
+// Every purchase makes the next copy of a unit this much more expensive,
+// unless the graph says otherwise.
+constexpr auto CostGrowth = 1.2;
+
 struct Unit;
 
+// A booster multiplies the yield of the generators it targets by factor. A
+// booster can also target other boosters, which scales their effect instead:
+// a booster with factor f whose own boosters multiply it by m acts as
+// 1 + (f - 1) * m on its targets.
 struct Boost {
     double factor;
-    const Unit *target;
+    std::vector<const Unit *> targets;
 };
 
 struct Unit {
@@ -91,6 +124,7 @@ struct Unit {
 
     std::u32string name;
     std::u32string description;
+    std::string category; // boosters can target a whole category in the graph file
     Type type = Type::Generator;
 
     glm::vec2 position;
@@ -101,16 +135,30 @@ struct Unit {
 
     std::vector<const Unit *> dependencies;
 
-    int count = 0;
+    std::size_t index = 0; // position in TechGraph::units
+    std::size_t sourceIndex = 0; // position in the graph file, which save games use
+    std::size_t level = 0; // length of the longest dependency chain below it
 
-    StateVector cost() const
+    StateVector cost(int count, double costGrowth = CostGrowth) const
     {
-        return baseCost * powf(1.2f, count);
+        return baseCost * std::pow(costGrowth, count);
     }
 };
 
 struct TechGraph {
     std::vector<std::unique_ptr<Unit>> units;
-    void reset();
+    // units of level l are units[levelOffsets[l]..levelOffsets[l + 1]]
+    std::vector<std::size_t> levelOffsets;
+    double costGrowth = CostGrowth;
+
+    // Also compiles the graph.
     bool load(const std::string &jsonPath);
+    bool save(const std::string &jsonPath) const;
+
+    // Checks that dependencies and boost targets point into the graph and
+    // that there are no dependency or boost cycles, computes every unit's level and
+    // renumbers the units level by level, so that dependencies always come
+    // first and traversals can be plain loops over units. Keeps the file
+    // order within a level.
+    bool compile();
 };
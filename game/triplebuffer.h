@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free handoff of the latest value from one writer thread to one reader
+// thread. The writer fills back() and publishes it, the reader picks up the
+// most recently published value with update() and reads it through front().
+// Neither side ever waits for the other; values published in between two
+// updates are simply skipped.
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T &initial)
+        : m_buffers { initial, initial, initial }
+    {
+    }
+
+    // writer
+    T &back() { return m_buffers[m_back]; }
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | Fresh, std::memory_order_acq_rel) & IndexMask;
+    }
+
+    // reader, returns whether front() changed
+    bool update()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & Fresh))
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & IndexMask;
+        return true;
+    }
+    const T &front() const { return m_buffers[m_front]; }
+
+private:
+    static constexpr uint8_t IndexMask = 3;
+    static constexpr uint8_t Fresh = 4; // middle buffer was published and not read yet
+
+    std::array<T, 3> m_buffers;
+    uint8_t m_back = 0;
+    std::atomic<uint8_t> m_middle = 1;
+    uint8_t m_front = 2;
+};
@@ -28,7 +28,7 @@ std::string pixmapPath(std::string_view basename)
 } // namespace
 
 UIPainter::UIPainter(GX::ShaderManager *shaderManager)
-    : m_spriteBatcher(new GX::SpriteBatcher(shaderManager))
+    : m_spriteBatcher(shaderManager ? new GX::SpriteBatcher(shaderManager) : nullptr)
     , m_grayscaleTextureAtlas(new GX::TextureAtlas(TextureAtlasPageSize, TextureAtlasPageSize, GX::PixelType::Grayscale))
     , m_rgbaTextureAtlas(new GX::TextureAtlas(TextureAtlasPageSize, TextureAtlasPageSize, GX::PixelType::RGBA))
 {
@@ -40,8 +40,10 @@ void UIPainter::resize(int width, int height)
 {
     updateSceneBox(width, height);
 
-    const auto projectionMatrix = glm::ortho(m_sceneBox.min.x, m_sceneBox.max.x, m_sceneBox.max.y, m_sceneBox.min.y, -1.0f, 1.0f);
-    m_spriteBatcher->setTransformMatrix(projectionMatrix);
+    if (m_spriteBatcher) {
+        const auto projectionMatrix = glm::ortho(m_sceneBox.min.x, m_sceneBox.max.x, m_sceneBox.max.y, m_sceneBox.min.y, -1.0f, 1.0f);
+        m_spriteBatcher->setTransformMatrix(projectionMatrix);
+    }
 }
 
 void UIPainter::startPainting()
@@ -55,6 +57,7 @@ void UIPainter::startPainting()
 void UIPainter::donePainting()
 {
     m_spriteBatcher->renderBatch();
+    m_spriteBatcher->finishFrame();
 }
 
 void UIPainter::setFont(const Font &font)
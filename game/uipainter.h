@@ -20,6 +20,9 @@ class AbstractTexture;
 class UIPainter : private GX::NonCopyable
 {
 public:
+    // Without a shader manager the painter can only lay out text (fonts,
+    // pixmaps and the scene box work, drawing doesn't), which needs no GL
+    // context.
     explicit UIPainter(GX::ShaderManager *shaderManager);
     ~UIPainter();
 
@@ -0,0 +1,241 @@
+#include "unitstore.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+constexpr auto Never = std::numeric_limits<double>::infinity();
+
+#ifdef USE_SSE2
+double horizontalSum(__m128d v)
+{
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+#endif
+} // namespace
+
+UnitStore::UnitStore(const TechGraph *techGraph)
+    : costGrowth(techGraph->costGrowth)
+{
+    const auto &units = techGraph->units;
+    const auto unitCount = units.size();
+
+    costExtropy.reserve(unitCount);
+    costEnergy.reserve(unitCount);
+    costMaterial.reserve(unitCount);
+    yieldExtropy.reserve(unitCount);
+    yieldEnergy.reserve(unitCount);
+    yieldMaterial.reserve(unitCount);
+    yieldCarbon.reserve(unitCount);
+    isBooster.reserve(unitCount);
+    boostFactors.reserve(unitCount);
+    boostTargetOffsets.reserve(unitCount + 1);
+    boostTargetOffsets.push_back(0);
+    boosterOffsets.assign(unitCount + 1, 0);
+    dependencyCounts.reserve(unitCount);
+    successorOffsets.assign(unitCount + 1, 0);
+
+    for (const auto &unit : units) {
+        const auto &cost = unit->baseCost;
+        costExtropy.push_back(static_cast<double>(cost.extropy));
+        costEnergy.push_back(static_cast<double>(cost.energy));
+        costMaterial.push_back(static_cast<double>(cost.material));
+
+        const auto generator = unit->type == Unit::Type::Generator;
+        const auto yield = generator ? unit->yield : StateVector {};
+        yieldExtropy.push_back(static_cast<double>(yield.extropy));
+        yieldEnergy.push_back(static_cast<double>(yield.energy));
+        yieldMaterial.push_back(static_cast<double>(yield.material));
+        yieldCarbon.push_back(static_cast<double>(yield.carbon));
+
+        isBooster.push_back(!generator);
+        boostFactors.push_back(generator ? 1.0 : unit->boost.factor);
+        if (!generator) {
+            for (const auto target : unit->boost.targets) {
+                boostTargets.push_back(target->index);
+                ++boosterOffsets[target->index + 1];
+            }
+        }
+        boostTargetOffsets.push_back(boostTargets.size());
+
+        dependencyCounts.push_back(unit->dependencies.size());
+        for (const auto dependency : unit->dependencies)
+            ++successorOffsets[dependency->index + 1];
+    }
+
+    // invert the dependency lists into successor lists
+    for (std::size_t i = 0; i < unitCount; ++i)
+        successorOffsets[i + 1] += successorOffsets[i];
+    successors.resize(successorOffsets.back());
+    auto next = successorOffsets;
+    for (const auto &unit : units) {
+        for (const auto dependency : unit->dependencies)
+            successors[next[dependency->index]++] = unit->index;
+    }
+
+    // and the boost target lists into booster lists
+    for (std::size_t i = 0; i < unitCount; ++i)
+        boosterOffsets[i + 1] += boosterOffsets[i];
+    boosters.resize(boosterOffsets.back());
+    next = boosterOffsets;
+    for (std::size_t i = 0; i < unitCount; ++i) {
+        for (auto j = boostTargetOffsets[i]; j < boostTargetOffsets[i + 1]; ++j)
+            boosters[next[boostTargets[j]]++] = i;
+    }
+
+    // Kahn's algorithm over the boost edges, TechGraph::compile made sure
+    // there are no cycles
+    std::vector<uint32_t> missingBoosters(unitCount);
+    boostOrder.reserve(unitCount);
+    for (std::size_t i = 0; i < unitCount; ++i) {
+        missingBoosters[i] = boosterOffsets[i + 1] - boosterOffsets[i];
+        if (missingBoosters[i] == 0)
+            boostOrder.push_back(i);
+    }
+    for (std::size_t i = 0; i < boostOrder.size(); ++i) {
+        const auto booster = boostOrder[i];
+        for (auto j = boostTargetOffsets[booster]; j < boostTargetOffsets[booster + 1]; ++j) {
+            if (--missingBoosters[boostTargets[j]] == 0)
+                boostOrder.push_back(boostTargets[j]);
+        }
+    }
+    assert(boostOrder.size() == unitCount);
+    boostRanks.resize(unitCount);
+    for (std::size_t i = 0; i < boostOrder.size(); ++i)
+        boostRanks[boostOrder[i]] = i;
+
+    resetCounts();
+}
+
+void UnitStore::resetCounts()
+{
+    counts.assign(costExtropy.size(), 0);
+    costScales.assign(costExtropy.size(), 1.0);
+    owned.assign(costExtropy.size(), false);
+    ownedCount = 0;
+    missingDependencies = dependencyCounts;
+    unlocked.resize(costExtropy.size());
+    for (std::size_t i = 0; i < unlocked.size(); ++i)
+        unlocked[i] = missingDependencies[i] == 0;
+}
+
+void UnitStore::setCount(std::size_t index, int count)
+{
+    counts[index] = count;
+    costScales[index] = std::pow(costGrowth, count);
+
+    if (owned[index] == (count > 0))
+        return;
+    owned[index] = count > 0;
+    if (count > 0)
+        ++ownedCount;
+    else
+        --ownedCount;
+    for (auto i = successorOffsets[index]; i < successorOffsets[index + 1]; ++i) {
+        const auto successor = successors[i];
+        if (count > 0)
+            --missingDependencies[successor];
+        else
+            ++missingDependencies[successor];
+        unlocked[successor] = missingDependencies[successor] == 0;
+    }
+}
+
+double UnitStore::seriesFactor(int amount) const
+{
+    if (amount == 1)
+        return 1.0; // exactly, the closed form is a few ulps off
+    return std::expm1(amount * std::log(costGrowth)) / (costGrowth - 1.0);
+}
+
+int UnitStore::maxAffordable(std::size_t index, const StateVector &state) const
+{
+    // solve budget >= cost * (g^n - 1) / (g - 1) for n, per component
+    const double costs[] = { costExtropy[index], costEnergy[index], costMaterial[index] };
+    const double budgets[] = { static_cast<double>(state.extropy), static_cast<double>(state.energy), static_cast<double>(state.material) };
+    const auto scale = costScales[index];
+    auto amount = static_cast<double>(std::numeric_limits<int>::max());
+    for (std::size_t component = 0; component < 3; ++component) {
+        if (costs[component] <= 0.0)
+            continue;
+        const auto budget = std::max(budgets[component], 0.0);
+        amount = std::min(amount, std::floor(std::log1p(budget * (costGrowth - 1.0) / (costs[component] * scale)) / std::log(costGrowth)));
+    }
+    return amount > 0.0 ? static_cast<int>(amount) : 0;
+}
+
+StateVector UnitStore::production(const std::vector<double> &multipliers) const
+{
+    const auto unitCount = size();
+    double extropy = 0.0, energy = 0.0, material = 0.0, carbon = 0.0;
+    std::size_t i = 0;
+#ifdef USE_SSE2
+    auto sumExtropy = _mm_setzero_pd();
+    auto sumEnergy = _mm_setzero_pd();
+    auto sumMaterial = _mm_setzero_pd();
+    auto sumCarbon = _mm_setzero_pd();
+    for (; i + 2 <= unitCount; i += 2) {
+        const auto count = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(&counts[i])));
+        const auto weight = _mm_mul_pd(count, _mm_loadu_pd(&multipliers[i]));
+        sumExtropy = _mm_add_pd(sumExtropy, _mm_mul_pd(weight, _mm_loadu_pd(&yieldExtropy[i])));
+        sumEnergy = _mm_add_pd(sumEnergy, _mm_mul_pd(weight, _mm_loadu_pd(&yieldEnergy[i])));
+        sumMaterial = _mm_add_pd(sumMaterial, _mm_mul_pd(weight, _mm_loadu_pd(&yieldMaterial[i])));
+        sumCarbon = _mm_add_pd(sumCarbon, _mm_mul_pd(weight, _mm_loadu_pd(&yieldCarbon[i])));
+    }
+    extropy = horizontalSum(sumExtropy);
+    energy = horizontalSum(sumEnergy);
+    material = horizontalSum(sumMaterial);
+    carbon = horizontalSum(sumCarbon);
+#endif
+    for (; i < unitCount; ++i) {
+        const auto weight = counts[i] * multipliers[i];
+        extropy += weight * yieldExtropy[i];
+        energy += weight * yieldEnergy[i];
+        material += weight * yieldMaterial[i];
+        carbon += weight * yieldCarbon[i];
+    }
+    return { Real(extropy), Real(energy), Real(material), Real(carbon) };
+}
+
+void UnitStore::timesUntilAffordable(const StateVector &state, const StateVector &delta, std::vector<double> &times) const
+{
+    const auto unitCount = size();
+    times.resize(unitCount);
+
+    // carbon is never a cost
+    const std::vector<double> *costs[] = { &costExtropy, &costEnergy, &costMaterial };
+    const double states[] = { static_cast<double>(state.extropy), static_cast<double>(state.energy), static_cast<double>(state.material) };
+    const double deltas[] = { static_cast<double>(delta.extropy), static_cast<double>(delta.energy), static_cast<double>(delta.material) };
+
+    std::size_t i = 0;
+#ifdef USE_SSE2
+    const auto zero = _mm_setzero_pd();
+    for (; i + 2 <= unitCount; i += 2) {
+        const auto scale = _mm_loadu_pd(&costScales[i]);
+        auto time = zero;
+        for (std::size_t component = 0; component < 3; ++component) {
+            const auto shortfall = _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(&(*costs[component])[i]), scale), _mm_set1_pd(states[component]));
+            const auto wait = deltas[component] > 0.0 ? _mm_div_pd(shortfall, _mm_set1_pd(deltas[component])) : _mm_set1_pd(Never);
+            // only components that aren't covered yet count
+            time = _mm_max_pd(time, _mm_and_pd(_mm_cmpgt_pd(shortfall, zero), wait));
+        }
+        _mm_storeu_pd(&times[i], time);
+    }
+#endif
+    for (; i < unitCount; ++i) {
+        double time = 0.0;
+        for (std::size_t component = 0; component < 3; ++component) {
+            const auto shortfall = (*costs[component])[i] * costScales[i] - states[component];
+            if (shortfall > 0.0)
+                time = std::max(time, deltas[component] > 0.0 ? shortfall / deltas[component] : Never);
+        }
+        times[i] = time;
+    }
+}
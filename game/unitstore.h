@@ -0,0 +1,83 @@
+#pragma once
+
+#include "techgraph.h"
+
+#include <cstdint>
+#include <vector>
+
+// Runtime state of the tech graph in structure-of-arrays form, so that the
+// per-unit loops of the simulation stream through contiguous arrays instead
+// of chasing Unit pointers and pulling names and positions into cache. Unit
+// stays the description record; index i here is TechGraph::units[i].
+struct UnitStore {
+    explicit UnitStore(const TechGraph *techGraph);
+
+    std::size_t size() const { return counts.size(); }
+    void resetCounts();
+    // Also keeps owned/unlocked up to date, which only costs anything when the
+    // count goes from or to zero.
+    void setCount(std::size_t index, int count);
+
+    // Cost of the next amount copies of the unit, a geometric series in
+    // costGrowth. Carbon is never a cost.
+    StateVector cost(std::size_t index, int amount = 1) const
+    {
+        const auto scale = costScales[index] * seriesFactor(amount);
+        return { Real(costExtropy[index] * scale), Real(costEnergy[index] * scale), Real(costMaterial[index] * scale), 0.0 };
+    }
+
+    // Largest amount of copies of the unit the state can pay for, in double
+    // precision; Simulation settles the rounding against the exact cost.
+    int maxAffordable(std::size_t index, const StateVector &state) const;
+
+    // 1 + g + g^2 + ... + g^(amount - 1)
+    double seriesFactor(int amount) const;
+
+    // Sum of count * multiplier * yield over all units.
+    StateVector production(const std::vector<double> &multipliers) const;
+
+    // For every unit, seconds until its current cost is covered by state
+    // growing at delta: zero if it's affordable now, infinity if it never
+    // will be. Computed in double precision; Simulation checks the result
+    // against the exact Real arithmetic.
+    void timesUntilAffordable(const StateVector &state, const StateVector &delta, std::vector<double> &times) const;
+
+    double costGrowth;
+
+    std::vector<int> counts;
+    std::vector<double> costScales; // costGrowth^count, the cost of the next copy relative to the base cost
+
+    std::vector<double> costExtropy;
+    std::vector<double> costEnergy;
+    std::vector<double> costMaterial;
+
+    // zero for boosters
+    std::vector<double> yieldExtropy;
+    std::vector<double> yieldEnergy;
+    std::vector<double> yieldMaterial;
+    std::vector<double> yieldCarbon;
+
+    std::vector<uint8_t> isBooster;
+    std::vector<double> boostFactors;
+
+    // units boosted by unit i are boostTargets[boostTargetOffsets[i]..boostTargetOffsets[i + 1]],
+    // boosters targeting unit i are boosters[boosterOffsets[i]..boosterOffsets[i + 1]]
+    std::vector<uint32_t> boostTargetOffsets;
+    std::vector<uint32_t> boostTargets;
+    std::vector<uint32_t> boosterOffsets;
+    std::vector<uint32_t> boosters;
+    // all units ordered so that boosters come before whatever they boost, and
+    // each unit's position in that order
+    std::vector<uint32_t> boostOrder;
+    std::vector<uint32_t> boostRanks;
+
+    std::vector<bool> owned; // count > 0
+    std::vector<bool> unlocked; // all dependencies owned
+    std::vector<uint32_t> missingDependencies; // dependencies not owned yet
+    std::vector<uint32_t> dependencyCounts;
+    std::size_t ownedCount = 0;
+
+    // units depending on unit i are successors[successorOffsets[i]..successorOffsets[i + 1]]
+    std::vector<uint32_t> successorOffsets;
+    std::vector<uint32_t> successors;
+};
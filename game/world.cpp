@@ -1,5 +1,6 @@
 #include "world.h"
 
+#include "savegame.h"
 #include "theme.h"
 #include "tween.h"
 #include "uipainter.h"
@@ -11,7 +12,6 @@
 #include <spdlog/spdlog.h>
 
 #include <glm/gtc/constants.hpp>
-#include <glm/gtc/random.hpp>
 #include <glm/gtx/string_cast.hpp>
 
 #include <algorithm>
@@ -25,43 +25,49 @@ std::string iconPath(std::string_view basename)
     return std::string("assets/images/") + std::string(basename);
 }
 
-std::tuple<int, int, char32_t> formattedValue(double value)
+// Scales the value below 1000 and returns the SI prefix to go with it, past
+// quetta the prefix is just a power of ten.
+std::pair<double, std::string> scaledValue(Real value)
 {
-    static const char32_t *units = U" kMGTPEZY";
-    size_t unit = 0;
-    while (value >= 1000) {
-        value /= 1000;
-        ++unit;
-    }
-    return { static_cast<int>(value), static_cast<int>(value * 1000) % 1000, units[unit] };
+    if (value < 1000)
+        return { static_cast<double>(value), {} };
+    static const char *prefixes[] = { "", "k", "M", "G", "T", "P", "E", "Z", "Y", "R", "Q" };
+    const auto [mantissa, exponent] = BigReal(value).toDecimal();
+    const auto group = exponent / 3;
+    if (static_cast<std::size_t>(group) < std::size(prefixes))
+        return { static_cast<double>(value) / std::pow(1000.0, group), prefixes[group] };
+    return { mantissa * std::pow(10.0, exponent % 3), fmt::format("e{}", 3 * group) };
+}
+
+std::tuple<int, int, std::string> formattedValue(Real value)
+{
+    const auto [scaled, prefix] = scaledValue(value);
+    return { static_cast<int>(scaled), static_cast<int>(scaled * 1000) % 1000, prefix };
 }
 
 constexpr const char *FontName = "Arimo-Regular.ttf";
 
 constexpr const auto BackgroundColor = glm::vec4(0.15, 0.15, 0.15, 1);
 
-template<typename StringT>
-void paintCentered(UIPainter *painter, float x, float y, const glm::vec4 &color, int depth, const StringT &s)
-{
-    const auto advance = painter->horizontalAdvance(s);
-    painter->drawText(glm::vec2(x - 0.5f * advance, y), color, depth, s);
-}
-
 class Wobble
 {
 public:
-    explicit Wobble(float radius);
+    Wobble(float radius, Random &random);
 
     void update(float elapsed);
     glm::vec2 offset() const;
 
 private:
     struct Wave {
-        Wave(float radius)
-            : dir(glm::circularRand(radius))
-            , phase(glm::linearRand(0.0f, 2.0f * glm::pi<float>()))
-            , speed(glm::linearRand(1.0f, 3.0f))
+        Wave(float radius, Random &random)
+            : dir(radius * direction(random.uniform(0.0, 2.0 * glm::pi<double>())))
+            , phase(random.uniform(0.0, 2.0 * glm::pi<double>()))
+            , speed(random.uniform(1.0, 3.0))
+        {
+        }
+        static glm::vec2 direction(double angle)
         {
+            return glm::vec2(std::cos(angle), std::sin(angle));
         }
         glm::vec2 eval(float t) const
         {
@@ -75,10 +81,10 @@ private:
     float m_t = 0.0f;
 };
 
-Wobble::Wobble(float radius)
+Wobble::Wobble(float radius, Random &random)
 {
-    std::generate_n(std::back_inserter(m_waves), 3, [radius] {
-        return Wave(glm::linearRand(0.5f * radius, radius));
+    std::generate_n(std::back_inserter(m_waves), 3, [radius, &random] {
+        return Wave(random.uniform(0.5 * radius, radius), random);
     });
 }
 
@@ -97,14 +103,15 @@ glm::vec2 Wobble::offset() const
 } // namespace
 
 static const auto UnitLabelFont = UIPainter::Font { FontName, 25 };
+static const auto CounterFont = UIPainter::Font { FontName, 20 };
 
 class GraphItem
 {
 public:
-    GraphItem(Unit *unit, const Theme *theme, World *world);
+    GraphItem(const Unit *unit, const Theme *theme, World *world);
     ~GraphItem();
 
-    bool mousePressEvent(const glm::vec2 &pos);
+    bool mousePressEvent(const glm::vec2 &pos, bool buyMax);
     void mouseReleaseEvent(const glm::vec2 &pos);
     void mouseMoveEvent(const glm::vec2 &pos);
 
@@ -112,6 +119,9 @@ public:
     glm::vec2 position() const;
     float radius() const;
     void update(double elapsed);
+    // Takes the snapshot's count as is, without animating the difference,
+    // after the counts were replaced (reset, restore).
+    void syncCount() { m_count = count(); }
     void paint(UIPainter *painter) const;
     bool contains(const glm::vec2 &pos) const;
     glm::vec4 color() const;
@@ -119,9 +129,10 @@ public:
     GX::BoxF boundingBox() const;
 
 private:
-    bool handleMousePress();
+    bool handleMousePress(bool buyMax);
     void handleMouseRelease();
     bool isSelected() const { return m_world->currentUnit() == m_unit; }
+    int count() const { return m_world->snapshot().count(m_unit); }
 
     const Theme *m_theme;
     World *m_world;
@@ -134,11 +145,15 @@ private:
     };
     State m_state = State::Hidden;
     State m_prevState = State::Hidden;
-    Unit *m_unit;
+    const Unit *m_unit;
     Wobble m_wobble;
     float m_stateTime = 0.0f;
     float m_stateTransitionTime = 0.0f;
     float m_acquireTime = 0.0f;
+    int m_count = 0; // as of the last update
+    mutable std::optional<uint64_t> m_countEpoch; // counts epoch the count text is for
+    mutable std::u32string m_countText;
+    mutable glm::vec2 m_countTextOffset; // from the counter's center
     GX::BoxF m_labelBox;
     GX::BoxF m_boundingBox;
 
@@ -148,21 +163,21 @@ private:
     static constexpr auto AcquireAnimationTime = 1.0f;
 };
 
-GraphItem::GraphItem(Unit *unit, const Theme *theme, World *world)
+GraphItem::GraphItem(const Unit *unit, const Theme *theme, World *world)
     : m_world(world)
     , m_theme(theme)
     , m_unit(unit)
-    , m_wobble(6.0f)
+    , m_wobble(6.0f, world->random())
 {
 }
 
 GraphItem::~GraphItem() = default;
 
-bool GraphItem::mousePressEvent(const glm::vec2 &pos)
+bool GraphItem::mousePressEvent(const glm::vec2 &pos, bool buyMax)
 {
     if (!contains(pos))
         return false;
-    return handleMousePress();
+    return handleMousePress(buyMax);
 }
 
 void GraphItem::mouseReleaseEvent(const glm::vec2 &pos)
@@ -182,6 +197,13 @@ void GraphItem::update(double elapsed)
     m_wobble.update(elapsed);
     if (m_acquireTime > 0.0f)
         m_acquireTime = std::max(static_cast<float>(m_acquireTime - elapsed), 0.0f);
+    // purchases happen on the simulation thread and may fail, so animate
+    // the ones that show up in the snapshot rather than the clicks
+    if (const auto count = this->count(); count != m_count) {
+        if (count > m_count)
+            m_acquireTime = AcquireAnimationTime;
+        m_count = count;
+    }
     static constexpr auto StateTransitionTime = 2.0f;
     static constexpr auto SelectionTime = 0.25f;
     const auto setState = [this](State state, float transitionTime) {
@@ -192,16 +214,7 @@ void GraphItem::update(double elapsed)
     };
     switch (m_state) {
     case State::Hidden: {
-        const auto shouldDisplay = [this] {
-            if (m_unit->count > 0)
-                return true;
-            const auto &dependencies = m_unit->dependencies;
-            if (dependencies.empty())
-                return true;
-            return std::all_of(dependencies.begin(), dependencies.end(), [](const Unit *unit) {
-                return unit->count > 0;
-            });
-        }();
+        const auto shouldDisplay = count() > 0 || m_world->snapshot().isUnlocked(m_unit);
         if (shouldDisplay)
             setState(State::Inactive, StateTransitionTime);
         if (isSelected())
@@ -209,7 +222,7 @@ void GraphItem::update(double elapsed)
         break;
     }
     case State::Inactive: {
-        if (m_unit->count > 0)
+        if (count() > 0)
             setState(State::Active, StateTransitionTime);
         if (isSelected())
             setState(State::Selected, SelectionTime);
@@ -221,7 +234,7 @@ void GraphItem::update(double elapsed)
         break;
     case State::Selected:
         if (!isSelected())
-            setState(m_unit->count > 0 ? State::Active : State::Inactive, SelectionTime);
+            setState(count() > 0 ? State::Active : State::Inactive, SelectionTime);
         break;
     }
 }
@@ -230,9 +243,10 @@ glm::vec2 GraphItem::position() const
 {
     auto p = m_unit->position;
     const auto wobbleWeight = [this] {
-        if (m_acquireTime > 0.0f && m_unit->count == 1)
+        const auto count = this->count();
+        if (m_acquireTime > 0.0f && count == 1)
             return m_acquireTime / AcquireAnimationTime;
-        return m_unit->count > 0 ? 0.0f : 1.0f;
+        return count > 0 ? 0.0f : 1.0f;
     }();
     p += wobbleWeight * m_wobble.offset();
     return p;
@@ -258,7 +272,7 @@ glm::vec4 GraphItem::color() const
         case State::Active:
             return m_theme->activeUnit.color;
         case State::Selected:
-            return m_unit->count > 0 ? m_theme->selectedUnit.color : m_theme->inactiveUnit.color;
+            return count() > 0 ? m_theme->selectedUnit.color : m_theme->inactiveUnit.color;
         default:
             assert(false);
             return {};
@@ -300,20 +314,20 @@ static const auto WarningAcceptText = "DISMISS"s;
 class WarningBox
 {
 public:
-    explicit WarningBox(const std::u32string &message, const Theme *theme);
+    // Lays the box out right away, clicks can hit it before it's painted.
+    WarningBox(const std::u32string &message, const Theme *theme, UIPainter *painter);
 
     bool update(double elapsed);
     bool mousePressEvent(const glm::vec2 &pos);
     void paint(UIPainter *painter) const;
 
 private:
-    void initialize(UIPainter *painter) const;
+    void initialize(UIPainter *painter);
     std::u32string m_message;
     const Theme *m_theme;
-    mutable bool m_initialized = false;
-    mutable GX::BoxF m_messageBox;
-    mutable glm::vec2 m_acceptPosition;
-    mutable GX::BoxF m_outerBox;
+    GX::BoxF m_messageBox;
+    glm::vec2 m_acceptPosition;
+    GX::BoxF m_outerBox;
     enum class State {
         FadeIn,
         Active,
@@ -329,10 +343,11 @@ private:
     static constexpr auto FadeOutTime = 0.5f;
 };
 
-WarningBox::WarningBox(const std::u32string &message, const Theme *theme)
+WarningBox::WarningBox(const std::u32string &message, const Theme *theme, UIPainter *painter)
     : m_message(message)
     , m_theme(theme)
 {
+    initialize(painter);
 }
 
 bool WarningBox::mousePressEvent(const glm::vec2 &pos)
@@ -347,11 +362,6 @@ bool WarningBox::mousePressEvent(const glm::vec2 &pos)
 
 void WarningBox::paint(UIPainter *painter) const
 {
-    if (!m_initialized) {
-        initialize(painter);
-        m_initialized = true;
-    }
-
     const auto alpha = [this] {
         switch (m_state) {
         case State::FadeIn:
@@ -388,7 +398,7 @@ void WarningBox::paint(UIPainter *painter) const
     painter->drawRoundedRect(m_outerBox, BoxRadius, backgroundColor, outlineColor, theme.outlineThickness, 19);
 }
 
-void WarningBox::initialize(UIPainter *painter) const
+void WarningBox::initialize(UIPainter *painter)
 {
     painter->setFont(WarningTextFont);
     const auto textSize = painter->textBoxSize(TextMaxWidth, m_message);
@@ -489,7 +499,8 @@ void GraphItem::paint(UIPainter *painter) const
     const auto color = this->color();
     painter->drawCircle(p, radius, glm::vec4(0), color, 5.0f, -1);
 
-    if (m_world->canAcquire(m_unit)) {
+    const auto &snapshot = m_world->snapshot();
+    if (snapshot.canAcquire(m_unit)) {
         const auto glowDistance = 0.04 + 0.02 * std::sin(m_stateTime * 5.0);
         const auto glowStrength = 0.6;
         painter->drawGlowCircle(p, radius, m_theme->glowColor, BackgroundColor, glowDistance, glowStrength, 5);
@@ -497,7 +508,7 @@ void GraphItem::paint(UIPainter *painter) const
         const auto acquirable = [this] {
             if (m_unit->type == Unit::Type::Generator)
                 return true;
-            return m_unit->count == 0;
+            return count() == 0;
         }();
         if (acquirable) {
             constexpr auto RadiusDelta = 8;
@@ -509,18 +520,19 @@ void GraphItem::paint(UIPainter *painter) const
             };
             float r = radius + RadiusDelta;
             const auto &colors = m_theme->gaugeColors;
-            const auto cost = m_unit->cost();
+            const auto cost = snapshot.cost(m_unit);
+            const auto state = m_world->displayedState();
             const auto alpha = theme.label.backgroundColor.w;
             if (cost.energy > 0) {
-                addCircleGauge(r, glm::vec4(colors.energy.xyz(), alpha), std::min(static_cast<float>(m_world->state().energy / cost.energy), 1.0f));
+                addCircleGauge(r, glm::vec4(colors.energy.xyz(), alpha), std::min(static_cast<float>(state.energy / cost.energy), 1.0f));
                 r += RadiusDelta;
             }
             if (cost.material > 0) {
-                addCircleGauge(r, glm::vec4(colors.material.xyz(), alpha), std::min(static_cast<float>(m_world->state().material / cost.material), 1.0f));
+                addCircleGauge(r, glm::vec4(colors.material.xyz(), alpha), std::min(static_cast<float>(state.material / cost.material), 1.0f));
                 r += RadiusDelta;
             }
             if (cost.extropy > 0) {
-                addCircleGauge(r, glm::vec4(colors.extropy.xyz(), alpha), std::min(static_cast<float>(m_world->state().extropy / cost.extropy), 1.0f));
+                addCircleGauge(r, glm::vec4(colors.extropy.xyz(), alpha), std::min(static_cast<float>(state.extropy / cost.extropy), 1.0f));
             }
         }
     }
@@ -538,18 +550,23 @@ void GraphItem::paint(UIPainter *painter) const
     constexpr auto BoxRadius = 8.0f;
     painter->drawRoundedRect(outerBox, BoxRadius, theme.label.backgroundColor, theme.label.outlineColor, theme.label.outlineThickness, 1);
 
-    const auto count = m_unit->count;
+    const auto count = this->count();
     if (count > 1) {
         const auto center = glm::vec2(outerBox.max.x, outerBox.min.y);
         constexpr const auto CounterRadius = 22.0f;
 
         painter->drawCircle(center, CounterRadius, theme.counter.backgroundColor, theme.counter.outlineColor, theme.counter.outlineThickness, 3);
 
-        const auto counterBox = GX::BoxF { center - 0.5f * glm::vec2(CounterRadius), center + 0.5f * glm::vec2(CounterRadius) };
-        painter->setVerticalAlign(UIPainter::VerticalAlign::Middle);
-        painter->setHorizontalAlign(UIPainter::HorizontalAlign::Center);
-        painter->setFont(UIPainter::Font { FontName, 20 });
-        painter->drawTextBox(counterBox, theme.counter.textColor, 4, fmt::format(U"x{}", count));
+        // centered on the counter, only rebuilt when some count changed
+        painter->setFont(CounterFont);
+        const auto countsEpoch = m_world->snapshot().epochs.counts;
+        if (m_countEpoch != countsEpoch) {
+            m_countText = fmt::format(U"x{}", count);
+            const auto *font = painter->font();
+            m_countTextOffset = glm::vec2(-0.5f * painter->horizontalAdvance(m_countText), 0.5f * (font->ascent() + font->descent()));
+            m_countEpoch = countsEpoch;
+        }
+        painter->drawText(center + m_countTextOffset, theme.counter.textColor, 4, m_countText);
     }
 }
 
@@ -563,10 +580,9 @@ bool GraphItem::contains(const glm::vec2 &pos) const
     return (m_labelBox + p).contains(pos);
 }
 
-bool GraphItem::handleMousePress()
+bool GraphItem::handleMousePress(bool buyMax)
 {
-    if (m_world->unitClicked(m_unit))
-        m_acquireTime = AcquireAnimationTime;
+    m_world->unitClicked(m_unit, buyMax);
     return true;
 }
 
@@ -579,24 +595,30 @@ bool GraphItem::isVisible() const
     return m_state != State::Hidden;
 }
 
-World::World() = default;
+World::World(uint32_t seed)
+    : m_random(seed)
+{
+}
+
 World::~World() = default;
 
-void World::initialize(const Theme *theme, UIPainter *painter, TechGraph *techGraph)
+void World::initialize(const Theme *theme, UIPainter *painter, SimulationThread *simulation)
 {
     m_theme = theme;
     m_painter = painter;
-    m_techGraph = techGraph;
+    m_simulation = simulation;
+
+    const auto &units = m_simulation->techGraph()->units;
 
     m_graphItems.clear();
-    for (auto &unit : m_techGraph->units) {
+    for (auto &unit : units) {
         auto item = std::make_unique<GraphItem>(unit.get(), m_theme, this);
         item->initialize(painter);
         m_unitItems[unit.get()] = item.get();
         m_graphItems.emplace_back(std::move(item));
     }
 
-    for (auto &unit : m_techGraph->units) {
+    for (auto &unit : units) {
         const auto *fromUnit = m_unitItems[unit.get()];
         for (const auto *dependency : unit->dependencies) {
             const auto *toUnit = m_unitItems[dependency];
@@ -619,31 +641,69 @@ void World::initialize(const Theme *theme, UIPainter *painter, TechGraph *techGr
 
 void World::reset()
 {
-    m_state.extropy = 0;
-    m_state.energy = 0;
-    m_state.material = 0;
-    m_state.carbon = 0;
-    m_currentUnit = nullptr;
-    m_techGraph->reset();
-
-    int leafNodes = 0;
+    m_simulation->reset();
+    for (auto &item : m_graphItems)
+        item->syncCount();
+    m_history.clear();
+    setCurrentUnit(nullptr);
+
+    // center on the units without dependencies, the first level
+    const auto *techGraph = m_simulation->techGraph();
+    const auto &levelOffsets = techGraph->levelOffsets;
+    const auto leafNodes = levelOffsets.size() > 1 ? levelOffsets[1] : 0;
     m_viewOffset = glm::vec2(0);
-    for (auto &unit : m_techGraph->units) {
-        if (unit->dependencies.empty()) {
-            ++leafNodes;
-            m_viewOffset -= unit->position;
-        }
-    }
-    m_viewOffset *= 1.0f / leafNodes;
+    for (std::size_t i = 0; i < leafNodes; ++i)
+        m_viewOffset -= techGraph->units[i]->position;
+    if (leafNodes > 0)
+        m_viewOffset *= 1.0f / leafNodes;
     m_viewScale = 1.0f;
 
     m_gameState = GameState::Intro;
-    m_warningBox = std::make_unique<WarningBox>(U"Click anywhere to increase your energy", m_theme);
+    m_warningBox = std::make_unique<WarningBox>(U"Click anywhere to increase your energy", m_theme, m_painter);
+}
+
+SaveGame World::saveGame() const
+{
+    SaveGame saveGame;
+    const auto &snapshot = this->snapshot();
+    const auto &units = m_simulation->techGraph()->units;
+    saveGame.counts.resize(units.size());
+    for (const auto &unit : units)
+        saveGame.counts[unit->sourceIndex] = snapshot.count(unit.get());
+    saveGame.state = snapshot.state;
+    saveGame.viewOffset = m_viewOffset;
+    saveGame.viewScale = m_viewScale;
+    saveGame.gameState = static_cast<int>(m_gameState);
+    return saveGame;
+}
+
+bool World::restore(const SaveGame &saveGame)
+{
+    if (saveGame.gameState < static_cast<int>(GameState::Intro) || saveGame.gameState > static_cast<int>(GameState::InGame))
+        return false;
+    const auto &units = m_simulation->techGraph()->units;
+    if (saveGame.counts.size() != units.size())
+        return false;
+    auto restored = saveGame;
+    for (const auto &unit : units)
+        restored.counts[unit->index] = saveGame.counts[unit->sourceIndex];
+    m_simulation->restore(restored);
+    for (auto &item : m_graphItems)
+        item->syncCount();
+    m_history.clear();
+    setCurrentUnit(nullptr);
+    m_viewOffset = saveGame.viewOffset;
+    m_viewScale = saveGame.viewScale;
+    m_gameState = static_cast<GameState>(saveGame.gameState);
+    if (m_gameState == GameState::InGame)
+        m_warningBox.reset();
+    return true;
 }
 
-void World::update(double elapsed)
+void World::update(double elapsed, double simulationLag)
 {
-    m_state += m_stateDelta * elapsed;
+    m_simulationLag = simulationLag;
+    m_history.append(elapsed, displayedState(), snapshot().stateDelta);
 
     if (m_warningBox) {
         if (!m_warningBox->update(elapsed))
@@ -658,23 +718,15 @@ void World::update(double elapsed)
 
     switch (m_gameState) {
     case GameState::Intro: {
-        const auto &units = m_techGraph->units;
-        const auto canAcquireUnit = std::any_of(units.begin(), units.end(), [this](const auto &unit) {
-            return canAcquire(unit.get());
-        });
-        if (canAcquireUnit) {
-            m_warningBox = std::make_unique<WarningBox>(U"Double click on a glowing circle to acquire an unit", m_theme);
+        if (snapshot().anyAcquirable) {
+            m_warningBox = std::make_unique<WarningBox>(U"Double click on a glowing circle to acquire an unit", m_theme, m_painter);
             m_gameState = GameState::BeforeFirstUnit;
         }
         break;
     }
     case GameState::BeforeFirstUnit: {
-        const auto &units = m_techGraph->units;
-        const auto unitAcquired = std::any_of(units.begin(), units.end(), [this](const auto &unit) {
-            return unit->count > 0;
-        });
-        if (unitAcquired) {
-            m_warningBox = std::make_unique<WarningBox>(U"That's it, now keep acquiring units until you have achieved zettawatt capacity. Good luck!", m_theme);
+        if (snapshot().anyAcquired) {
+            m_warningBox = std::make_unique<WarningBox>(U"That's it, now keep acquiring units until you have achieved zettawatt capacity. Good luck!", m_theme, m_painter);
             m_gameState = GameState::InGame;
         }
         break;
@@ -684,22 +736,6 @@ void World::update(double elapsed)
     }
 }
 
-void World::updateStateDelta()
-{
-    StateVector delta;
-    for (const auto &unit : m_techGraph->units) {
-        if (!unit->count || unit->type != Unit::Type::Generator)
-            continue;
-        float boost = 1.0f;
-        for (const auto &other : m_techGraph->units) {
-            if (other->type == Unit::Type::Booster && other->count > 0 && other->boost.target == unit.get())
-                boost *= other->boost.factor;
-        }
-        delta += unit->count * boost * unit->yield;
-    }
-    m_stateDelta = delta;
-}
-
 void World::paint() const
 {
     paintGraph();
@@ -749,7 +785,14 @@ void World::paintState() const
     constexpr auto CounterWidth = 320.0f;
     constexpr auto CounterHeight = 160.0f;
 
-    auto paintCounter = [this](float centerX, float centerY, const std::u32string &label, const std::string &unit, const GX::PackedPixmap &icon, double value, double delta) {
+    static const auto LabelFont = UIPainter::Font { FontName, 40 };
+    static const auto CounterFontBig = UIPainter::Font { FontName, 70 };
+    static const auto CounterFontSmall = UIPainter::Font { FontName, 40 };
+    static const auto DeltaFont = UIPainter::Font { FontName, 40 };
+
+    const auto stateEpoch = snapshot().epochs.state;
+
+    auto paintCounter = [this, stateEpoch](CounterLayout &layout, float centerX, float centerY, const std::u32string &label, const std::string &unit, const GX::PackedPixmap &icon, Real value, Real delta) {
         if (value == 0.0)
             return;
 
@@ -758,81 +801,86 @@ void World::paintState() const
         const auto box = GX::BoxF { glm::vec2(centerX - 0.5 * CounterWidth, centerY - 0.5 * CounterHeight), glm::vec2(centerX + 0.5 * CounterWidth, centerY + 0.5 * CounterHeight) };
         m_painter->drawRoundedRect(box, 20, theme.backgroundColor, theme.outlineColor, theme.outlineThickness, TextDepth - 1);
 
-        static const auto LabelFont = UIPainter::Font { FontName, 40 };
-        static const auto CounterFontBig = UIPainter::Font { FontName, 70 };
-        static const auto CounterFontSmall = UIPainter::Font { FontName, 40 };
-        static const auto DeltaFont = UIPainter::Font { FontName, 40 };
-
         float y = centerY - 40;
 
         // label
         {
             m_painter->setFont(LabelFont);
-            const auto advance = m_painter->horizontalAdvance(label) + icon.width;
-            auto x = centerX - 0.5f * advance;
-            const auto textHeight = m_painter->font()->ascent() + m_painter->font()->descent();
+            if (layout.labelAdvance < 0.0f) {
+                layout.labelAdvance = m_painter->horizontalAdvance(label);
+                layout.labelHeight = m_painter->font()->ascent() + m_painter->font()->descent();
+            }
+            auto x = centerX - 0.5f * (layout.labelAdvance + icon.width);
             // is this even right lol
-            m_painter->drawPixmap(glm::vec2(x, y - 0.5f * (textHeight + icon.height)), icon, TextDepth);
+            m_painter->drawPixmap(glm::vec2(x, y - 0.5f * (layout.labelHeight + icon.height)), icon, TextDepth);
             x += icon.width;
             m_painter->drawText(glm::vec2(x, y), theme.labelColor, TextDepth, label);
         }
         y += 60;
 
-        // counter
+        // counter, the text only changes when the shown digits do
         {
-            const auto [big, small, power] = formattedValue(value);
-            if (power != ' ') {
-                const auto bigText = fmt::format("{}", big);
-                const auto smallText = fmt::format(".{:03d}", small);
-                const auto unitText = power != ' ' ? fmt::format("{}{}", static_cast<char>(power), unit) : unit;
-
-                m_painter->setFont(CounterFontBig);
-                const auto bigAdvance = m_painter->horizontalAdvance(bigText);
-                const auto unitAdvance = m_painter->horizontalAdvance(unitText);
-
-                m_painter->setFont(CounterFontSmall);
-                const auto smallAdvance = m_painter->horizontalAdvance(smallText);
-
-                const auto totalAdvance = bigAdvance + smallAdvance + unitAdvance;
-
-                const auto left = centerX - 0.5f * totalAdvance;
-
-                m_painter->setFont(CounterFontBig);
-                m_painter->drawText(glm::vec2(left, y), theme.valueColor, TextDepth, bigText);
-                m_painter->drawText(glm::vec2(left + bigAdvance + smallAdvance, y), theme.valueColor, TextDepth, unitText);
+            auto formatted = formattedValue(value);
+            if (formatted != layout.value) {
+                const auto &[big, small, power] = formatted;
+                if (!power.empty()) {
+                    layout.bigText = fmt::format("{}", big);
+                    layout.smallText = fmt::format(".{:03d}", small);
+                    layout.unitText = power + unit;
+                    m_painter->setFont(CounterFontBig);
+                    layout.bigAdvance = m_painter->horizontalAdvance(layout.bigText);
+                    layout.unitAdvance = m_painter->horizontalAdvance(layout.unitText);
+                    m_painter->setFont(CounterFontSmall);
+                    layout.smallAdvance = m_painter->horizontalAdvance(layout.smallText);
+                } else {
+                    layout.bigText = fmt::format("{}{}", big, unit);
+                    m_painter->setFont(CounterFontBig);
+                    layout.bigAdvance = m_painter->horizontalAdvance(layout.bigText);
+                    layout.smallText.clear();
+                    layout.unitText.clear();
+                    layout.smallAdvance = layout.unitAdvance = 0.0f;
+                }
+                layout.value = std::move(formatted);
+            }
 
+            const auto left = centerX - 0.5f * (layout.bigAdvance + layout.smallAdvance + layout.unitAdvance);
+            m_painter->setFont(CounterFontBig);
+            m_painter->drawText(glm::vec2(left, y), theme.valueColor, TextDepth, layout.bigText);
+            if (!layout.smallText.empty()) {
+                m_painter->drawText(glm::vec2(left + layout.bigAdvance + layout.smallAdvance, y), theme.valueColor, TextDepth, layout.unitText);
                 m_painter->setFont(CounterFontSmall);
-                m_painter->drawText(glm::vec2(left + bigAdvance, y), theme.valueColor, TextDepth, smallText);
-            } else {
-                const auto text = fmt::format("{}{}", big, unit);
-                m_painter->setFont(CounterFontBig);
-                paintCentered(m_painter, centerX, y, theme.valueColor, TextDepth, text);
+                m_painter->drawText(glm::vec2(left + layout.bigAdvance, y), theme.valueColor, TextDepth, layout.smallText);
             }
         }
         y += 40;
 
-        // delta
+        // delta, only changes at simulation checkpoints
         {
-            const auto text = [&] {
+            m_painter->setFont(DeltaFont);
+            if (layout.deltaEpoch != stateEpoch) {
                 const auto [big, small, power] = formattedValue(delta);
-                if (power == ' ') {
-                    return fmt::format("{}{}/s", big, unit);
+                if (power.empty()) {
+                    layout.deltaText = fmt::format("{}{}/s", big, unit);
                 } else {
-                    return fmt::format("{}.{:03d}{}{}/s", big, small, static_cast<char>(power), unit);
+                    layout.deltaText = fmt::format("{}.{:03d}{}{}/s", big, small, power, unit);
                 }
-            }();
-            m_painter->setFont(DeltaFont);
-            paintCentered(m_painter, centerX, y, theme.deltaColor, TextDepth, text);
+                layout.deltaAdvance = m_painter->horizontalAdvance(layout.deltaText);
+                layout.deltaEpoch = stateEpoch;
+            }
+            m_painter->drawText(glm::vec2(centerX - 0.5f * layout.deltaAdvance, y), theme.deltaColor, TextDepth, layout.deltaText);
         }
     };
 
     const GX::BoxF sceneBox = m_painter->sceneBox();
     const float y = sceneBox.min.y + 0.5 * CounterHeight;
 
-    paintCounter(-1.5f * CounterWidth, y, U"ENERGY"s, "Wh"s, m_energyIcon, m_state.energy, m_stateDelta.energy);
-    paintCounter(-.5f * CounterWidth, y, U"MATERIALS"s, "t"s, m_materialIcon, m_state.material, m_stateDelta.material);
-    paintCounter(.5f * CounterWidth, y, U"CO\U00002082"s, "t"s, m_carbonIcon, m_state.carbon, m_stateDelta.carbon);
-    paintCounter(1.5f * CounterWidth, y, U"EXTROPY"s, ""s, m_extropyIcon, m_state.extropy, m_stateDelta.extropy);
+    const auto state = displayedState();
+    const auto stateDelta = snapshot().stateDelta;
+
+    paintCounter(m_counterLayouts[0], -1.5f * CounterWidth, y, U"ENERGY"s, "Wh"s, m_energyIcon, state.energy, stateDelta.energy);
+    paintCounter(m_counterLayouts[1], -.5f * CounterWidth, y, U"MATERIALS"s, "t"s, m_materialIcon, state.material, stateDelta.material);
+    paintCounter(m_counterLayouts[2], .5f * CounterWidth, y, U"CO\U00002082"s, "t"s, m_carbonIcon, state.carbon, stateDelta.carbon);
+    paintCounter(m_counterLayouts[3], 1.5f * CounterWidth, y, U"EXTROPY"s, ""s, m_extropyIcon, state.extropy, stateDelta.extropy);
 }
 
 void World::paintCurrentUnitDescription() const
@@ -842,23 +890,6 @@ void World::paintCurrentUnitDescription() const
 
     const auto &theme = m_theme->unitDetails;
 
-    // cost
-    const auto formatCost = [](double value, const std::u32string &unit) -> std::u32string {
-        if (value == 0.0)
-            return {};
-        static const char32_t *factors = U" kMGTPEZY";
-        size_t factor = 0;
-        while (value >= 1000) {
-            value /= 1000;
-            ++factor;
-        }
-        if (factor > 0)
-            return fmt::format(U"{:.1f}{}{}", value, factors[factor], unit);
-        else
-            return fmt::format(U"{:.1f}{}", value, unit);
-    };
-    const auto cost = m_currentUnit->cost();
-
     static const auto TitleFont = UIPainter::Font { FontName, 25 };
     static const auto DescriptionFont = UIPainter::Font { FontName, 20 };
 
@@ -867,32 +898,82 @@ void World::paintCurrentUnitDescription() const
     constexpr auto Margin = 10.0f;
     constexpr auto BoxRadius = 8.0f;
 
-    float textHeight = 0.0f;
+    constexpr auto TitleTextWidth = TitleMaxWidth + 1.0f;
+    constexpr auto TextWidth = MaxWidth + 1.0f;
 
-    // cost
-    m_painter->setFont(DescriptionFont);
-    const auto costLines = (cost.energy > 0.0) + (cost.material > 0.0) + (cost.extropy > 0.0);
-    const auto costHeight = costLines * m_painter->font()->pixelHeight();
+    static const auto YieldPrefix = "Produces "s;
 
-    // title
-    m_painter->setFont(TitleFont);
-    auto titleSize = m_painter->textBoxSize(TitleMaxWidth, m_currentUnit->name);
-    titleSize.y = std::max(titleSize.y, static_cast<float>(costHeight));
-    textHeight += titleSize.y;
+    // everything but the cost is fixed for a unit, and the cost only changes
+    // with the counts
+    auto &layout = m_unitDescriptionLayout;
+    const auto epochs = std::make_pair(m_selectionEpoch, snapshot().epochs.costs);
+    if (layout.epochs != epochs) {
+        layout.epochs = epochs;
 
-    // description
-    m_painter->setFont(DescriptionFont);
-    const auto descriptionSize = m_painter->textBoxSize(MaxWidth, m_currentUnit->description);
-    textHeight += descriptionSize.y;
+        const auto formatCost = [](Real value, const std::u32string &unit) -> std::u32string {
+            if (value == 0.0)
+                return {};
+            const auto [scaled, prefix] = scaledValue(value);
+            return fmt::format(U"{:.1f}{}{}", scaled, std::u32string(prefix.begin(), prefix.end()), unit);
+        };
+        const auto addItem = [this](std::vector<UnitDescriptionLayout::Item> &items, std::u32string text, const GX::PackedPixmap &icon) {
+            const auto advance = m_painter->horizontalAdvance(text);
+            items.push_back({ std::move(text), advance, &icon });
+        };
 
-    // boost/yield
-    if (m_currentUnit->type == Unit::Type::Generator || m_currentUnit->boost.target)
-        textHeight += m_painter->font()->pixelHeight();
+        // cost
+        m_painter->setFont(DescriptionFont);
+        const auto cost = snapshot().cost(m_currentUnit);
+        layout.costs.clear();
+        if (cost.energy > 0.0)
+            addItem(layout.costs, formatCost(cost.energy, U"Wh"s), m_energyIconSmall);
+        if (cost.material > 0.0)
+            addItem(layout.costs, formatCost(cost.material, U"t"s), m_materialIconSmall);
+        if (cost.extropy > 0.0)
+            addItem(layout.costs, formatCost(cost.extropy, U""s), m_extropyIconSmall);
+        const auto costHeight = layout.costs.size() * m_painter->font()->pixelHeight();
 
-    constexpr auto TitleTextWidth = TitleMaxWidth + 1.0f;
-    constexpr auto TextWidth = MaxWidth + 1.0f;
+        // title
+        m_painter->setFont(TitleFont);
+        layout.titleSize = m_painter->textBoxSize(TitleMaxWidth, m_currentUnit->name);
+        layout.titleSize.y = std::max(layout.titleSize.y, static_cast<float>(costHeight));
+        layout.textHeight = layout.titleSize.y;
 
-    const auto topLeft = m_painter->sceneBox().max - glm::vec2(TextWidth + Margin, textHeight + Margin);
+        // description
+        m_painter->setFont(DescriptionFont);
+        layout.descriptionSize = m_painter->textBoxSize(MaxWidth, m_currentUnit->description);
+        layout.textHeight += layout.descriptionSize.y;
+
+        // boost/yield
+        const auto &targets = m_currentUnit->boost.targets;
+        if (m_currentUnit->type == Unit::Type::Generator || !targets.empty())
+            layout.textHeight += m_painter->font()->pixelHeight();
+        layout.boostDescription.clear();
+        layout.yields.clear();
+        if (m_currentUnit->type == Unit::Type::Booster) {
+            if (!targets.empty()) {
+                const auto factor = m_currentUnit->boost.factor;
+                const auto boosted = targets.size() == 1 ? targets.front()->name : fmt::format(U"{} units", targets.size());
+                if (factor > 1.0)
+                    layout.boostDescription = fmt::format(U"{} {}% more efficient", boosted, static_cast<int>((factor - 1) * 100 + 0.5f));
+                else
+                    layout.boostDescription = fmt::format(U"{} {}% less efficient", boosted, static_cast<int>((1 - factor) * 100 + 0.5f));
+            }
+        } else {
+            layout.yieldPrefixAdvance = m_painter->horizontalAdvance(YieldPrefix);
+            const auto &yield = m_currentUnit->yield;
+            if (yield.energy > 0.0)
+                addItem(layout.yields, formatCost(yield.energy, U"Wh/s"), m_energyIconSmall);
+            if (yield.material > 0.0)
+                addItem(layout.yields, formatCost(yield.material, U"t/s"), m_materialIconSmall);
+            if (yield.carbon > 0.0)
+                addItem(layout.yields, formatCost(yield.carbon, U"t/s"), m_carbonIconSmall);
+            if (yield.extropy > 0.0)
+                addItem(layout.yields, formatCost(yield.extropy, U"/s"), m_extropyIconSmall);
+        }
+    }
+
+    const auto topLeft = m_painter->sceneBox().max - glm::vec2(TextWidth + Margin, layout.textHeight + Margin);
 
     m_painter->setVerticalAlign(UIPainter::VerticalAlign::Top);
     m_painter->setHorizontalAlign(UIPainter::HorizontalAlign::Left);
@@ -901,73 +982,45 @@ void World::paintCurrentUnitDescription() const
     {
         glm::vec2 p = topLeft;
         m_painter->setFont(TitleFont);
-        m_painter->drawTextBox(GX::BoxF { p, p + glm::vec2(TitleTextWidth, titleSize.y) }, theme.titleColor, 20, m_currentUnit->name);
+        m_painter->drawTextBox(GX::BoxF { p, p + glm::vec2(TitleTextWidth, layout.titleSize.y) }, theme.titleColor, 20, m_currentUnit->name);
 
-        p += glm::vec2(0, titleSize.y);
+        p += glm::vec2(0, layout.titleSize.y);
         m_painter->setFont(DescriptionFont);
-        m_painter->drawTextBox(GX::BoxF { p, p + glm::vec2(TextWidth, descriptionSize.y) }, theme.descriptionColor, 20, m_currentUnit->description);
+        m_painter->drawTextBox(GX::BoxF { p, p + glm::vec2(TextWidth, layout.descriptionSize.y) }, theme.descriptionColor, 20, m_currentUnit->description);
 
-        p += glm::vec2(0, descriptionSize.y + m_painter->font()->ascent());
+        p += glm::vec2(0, layout.descriptionSize.y + m_painter->font()->ascent());
         if (m_currentUnit->type == Unit::Type::Booster) {
-            if (m_currentUnit->boost.target) {
-                std::u32string boostDescription;
-                const auto factor = m_currentUnit->boost.factor;
-                if (factor > 1.0)
-                    boostDescription = fmt::format(U"{} {}% more efficient", m_currentUnit->boost.target->name, static_cast<int>((factor - 1) * 100 + 0.5f));
-                else
-                    boostDescription = fmt::format(U"{} {}% less efficient", m_currentUnit->boost.target->name, static_cast<int>((1 - factor) * 100 + 0.5f));
-
-                m_painter->drawText(p, glm::vec4(1, 1, 0, 1), 20, boostDescription);
-            }
+            if (!layout.boostDescription.empty())
+                m_painter->drawText(p, glm::vec4(1, 1, 0, 1), 20, layout.boostDescription);
         } else {
-            static const auto prefix = "Produces "s;
-            m_painter->drawText(p, theme.yieldColor, 20, prefix);
-            p += glm::vec2(m_painter->horizontalAdvance(prefix), 0);
-            const auto drawYield = [this, &theme, &p](const std::u32string &text, const GX::PackedPixmap &icon) {
-                if (text.empty())
-                    return;
-                const auto textHeight = m_painter->font()->ascent() + m_painter->font()->descent();
+            m_painter->drawText(p, theme.yieldColor, 20, YieldPrefix);
+            p += glm::vec2(layout.yieldPrefixAdvance, 0);
+            const auto textHeight = m_painter->font()->ascent() + m_painter->font()->descent();
+            for (const auto &yield : layout.yields) {
+                const auto &icon = *yield.icon;
                 m_painter->drawPixmap(glm::vec2(p.x, p.y - 0.5f * (textHeight + icon.height)), icon, 20);
                 p.x += icon.width;
-                m_painter->drawText(p, theme.yieldColor, 20, text);
-                p.x += m_painter->horizontalAdvance(text);
-            };
-            const auto &yield = m_currentUnit->yield;
-            if (yield.energy > 0.0)
-                drawYield(formatCost(yield.energy, U"Wh/s"), m_energyIconSmall);
-            if (yield.material > 0.0)
-                drawYield(formatCost(yield.material, U"t/s"), m_materialIconSmall);
-            if (yield.carbon > 0.0)
-                drawYield(formatCost(yield.carbon, U"t/s"), m_carbonIconSmall);
-            if (yield.extropy > 0.0)
-                drawYield(formatCost(yield.extropy, U"/s"), m_extropyIconSmall);
+                m_painter->drawText(p, theme.yieldColor, 20, yield.text);
+                p.x += yield.advance;
+            }
         }
     }
 
     // paint cost
     {
         glm::vec2 p = topLeft + glm::vec2(TextWidth, m_painter->font()->ascent());
-
-        const auto drawCost = [this, &theme, &p](const std::u32string &text, const GX::PackedPixmap &icon) {
-            if (text.empty())
-                return;
-            const auto advance = m_painter->horizontalAdvance(text) + icon.width;
-            const auto textHeight = m_painter->font()->ascent() + m_painter->font()->descent();
-            auto x = p.x - advance;
+        const auto textHeight = m_painter->font()->ascent() + m_painter->font()->descent();
+        for (const auto &cost : layout.costs) {
+            const auto &icon = *cost.icon;
+            auto x = p.x - (cost.advance + icon.width);
             m_painter->drawPixmap(glm::vec2(x, p.y - 0.5f * (textHeight + icon.height)), icon, 20);
             x += icon.width;
-            m_painter->drawText(glm::vec2(x, p.y), theme.costColor, 20, text);
+            m_painter->drawText(glm::vec2(x, p.y), theme.costColor, 20, cost.text);
             p.y += m_painter->font()->pixelHeight();
-        };
-        if (cost.energy > 0.0)
-            drawCost(formatCost(cost.energy, U"Wh"s), m_energyIconSmall);
-        if (cost.material > 0.0)
-            drawCost(formatCost(cost.material, U"t"s), m_materialIconSmall);
-        if (cost.extropy > 0.0)
-            drawCost(formatCost(cost.extropy, U""s), m_extropyIconSmall);
+        }
     }
 
-    const auto outerBox = GX::BoxF { topLeft - glm::vec2(Margin, Margin), topLeft + glm::vec2(TextWidth + Margin, textHeight + Margin) };
+    const auto outerBox = GX::BoxF { topLeft - glm::vec2(Margin, Margin), topLeft + glm::vec2(TextWidth + Margin, layout.textHeight + Margin) };
     m_painter->drawRoundedRect(outerBox, BoxRadius, theme.backgroundColor, theme.outlineColor, theme.outlineThickness, 19);
 }
 
@@ -984,7 +1037,7 @@ void World::mousePressEvent(MouseButton button, const glm::vec2 &pos)
         } else {
             const auto scenePos = pos * (1.0f / m_viewScale) - m_viewOffset;
             for (auto &item : m_graphItems) {
-                if (item->mousePressEvent(scenePos))
+                if (item->mousePressEvent(scenePos, false))
                     accepted = true;
             }
             m_panningView = !accepted;
@@ -993,6 +1046,15 @@ void World::mousePressEvent(MouseButton button, const glm::vec2 &pos)
         m_elapsedSinceClick = 0.0;
         break;
     }
+    case MouseButton::Right: {
+        // buy as many as we can afford
+        if (!m_warningBox) {
+            const auto scenePos = pos * (1.0f / m_viewScale) - m_viewOffset;
+            for (auto &item : m_graphItems)
+                item->mousePressEvent(scenePos, true);
+        }
+        break;
+    }
     case MouseButton::WheelDown: {
         m_viewScale = std::max(MinZoomFactor, m_viewScale * (1.0f / ZoomFactor));
         clampViewOffset();
@@ -1014,7 +1076,7 @@ void World::mouseReleaseEvent(MouseButton button, const glm::vec2 &pos)
     case MouseButton::Left: {
         if (m_panningView) {
             if (m_elapsedSinceClick < 0.5)
-                m_state.energy += glm::linearRand(5, 8);
+                m_simulation->addEnergy(5 + static_cast<int>(m_random.below(4))); // 5 to 8
         } else {
             if (!m_warningBox) {
                 for (auto &item : m_graphItems)
@@ -1060,35 +1122,17 @@ void World::clampViewOffset()
     m_viewOffset = glm::min(m_viewOffset, -min + 0.5f * viewportSize);
 }
 
-bool World::unitClicked(Unit *unit)
+void World::unitClicked(const Unit *unit, bool buyMax)
 {
-    bool acquired = false;
-    if (unit == m_currentUnit) {
-        if (canAcquire(unit)) {
-            m_state -= unit->cost();
-            ++unit->count;
-            updateStateDelta();
-            acquired = true;
-        }
-    }
-    m_currentUnit = unit;
-    return acquired;
+    if (unit == m_currentUnit)
+        m_simulation->acquire(unit, buyMax);
+    setCurrentUnit(unit);
 }
 
-bool World::canAcquire(const Unit *unit) const
+void World::setCurrentUnit(const Unit *unit)
 {
-    if (unit->type == Unit::Type::Booster && unit->count > 0)
-        return false;
-    auto hasDependencies = [unit] {
-        const auto &dependencies = unit->dependencies;
-        if (dependencies.empty())
-            return true;
-        return std::all_of(dependencies.begin(), dependencies.end(), [](const Unit *unit) {
-            return unit->count > 0;
-        });
-    }();
-    if (!hasDependencies)
-        return false;
-    const auto cost = unit->cost();
-    return cost.extropy <= m_state.extropy && cost.energy <= m_state.energy && cost.material <= m_state.material;
+    if (unit == m_currentUnit)
+        return;
+    m_currentUnit = unit;
+    ++m_selectionEpoch;
 }
@@ -1,17 +1,23 @@
 #pragma once
 
 #include "gamewindow.h"
-#include "techgraph.h"
+#include "random.h"
+#include "simulationthread.h"
+#include "statehistory.h"
 
 #include <textureatlas.h>
 #include <util.h>
 
+#include <array>
 #include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
 class UIPainter;
+struct SaveGame;
 struct Unit;
 class GraphItem;
 struct Theme;
@@ -20,40 +26,48 @@ class WarningBox;
 class World
 {
 public:
-    World();
+    // seed for the animations and harvesting, the same seed replays the same session
+    explicit World(uint32_t seed);
     ~World();
 
     void setViewportSize(const glm::vec2 &viewportSize);
-    void initialize(const Theme *theme, UIPainter *painter, TechGraph *techGraph);
+    void initialize(const Theme *theme, UIPainter *painter, SimulationThread *simulation);
     void reset();
 
-    void update(double elapsed);
+    SaveGame saveGame() const;
+    bool restore(const SaveGame &saveGame);
+
+    // simulationLag is how far the frame is ahead of the simulation snapshot
+    void update(double elapsed, double simulationLag);
     void paint() const;
 
     void mousePressEvent(MouseButton button, const glm::vec2 &pos);
     void mouseReleaseEvent(MouseButton button, const glm::vec2 &pos);
     void mouseMoveEvent(const glm::vec2 &pos);
 
-    bool unitClicked(Unit *unit);
-
-    bool canAcquire(const Unit *unit) const;
-
-    StateVector state() const { return m_state; }
+    void unitClicked(const Unit *unit, bool buyMax = false);
 
+    const SimulationSnapshot &snapshot() const { return m_simulation->snapshot(); }
+    // simulated state interpolated to the current frame
+    StateVector displayedState() const { return snapshot().stateAfter(m_simulationLag); }
     const Unit *currentUnit() const { return m_currentUnit; }
+    Random &random() { return m_random; }
+    // displayed state and its rate of change since the game started or was restored
+    const StateHistory &history() const { return m_history; }
 
 private:
     void paintState() const;
     void paintGraph() const;
     void paintCurrentUnitDescription() const;
-    void updateStateDelta();
     void clampViewOffset();
+    void setCurrentUnit(const Unit *unit);
 
     const Theme *m_theme = nullptr;
     UIPainter *m_painter = nullptr;
-    StateVector m_state;
-    StateVector m_stateDelta;
-    TechGraph *m_techGraph;
+    SimulationThread *m_simulation = nullptr;
+    Random m_random;
+    double m_simulationLag = 0.0;
+    StateHistory m_history;
     std::vector<std::unique_ptr<GraphItem>> m_graphItems;
     std::unordered_map<const Unit *, const GraphItem *> m_unitItems;
     struct Edge {
@@ -74,8 +88,44 @@ private:
     GX::PackedPixmap m_materialIconSmall;
     GX::PackedPixmap m_carbonIcon;
     GX::PackedPixmap m_carbonIconSmall;
-    Unit *m_currentUnit = nullptr;
+    const Unit *m_currentUnit = nullptr;
+    uint64_t m_selectionEpoch = 0; // bumped when m_currentUnit changes
     std::unique_ptr<WarningBox> m_warningBox;
+
+    // Formatted text and measurements of the state counters and the unit
+    // description, kept across frames and only rebuilt when what they show
+    // changes (see SimulationEpochs).
+    struct CounterLayout {
+        float labelAdvance = -1.0f; // not measured yet
+        float labelHeight = 0.0f;
+        std::optional<std::tuple<int, int, std::string>> value; // formattedValue() the text is for
+        std::string bigText;
+        std::string smallText;
+        std::string unitText;
+        float bigAdvance = 0.0f;
+        float smallAdvance = 0.0f;
+        float unitAdvance = 0.0f;
+        std::optional<uint64_t> deltaEpoch; // state epoch the delta text is for
+        std::string deltaText;
+        float deltaAdvance = 0.0f;
+    };
+    mutable std::array<CounterLayout, 4> m_counterLayouts;
+    struct UnitDescriptionLayout {
+        std::optional<std::pair<uint64_t, uint64_t>> epochs; // selection and costs epochs it's for
+        glm::vec2 titleSize;
+        glm::vec2 descriptionSize;
+        float textHeight = 0.0f;
+        std::u32string boostDescription;
+        float yieldPrefixAdvance = 0.0f;
+        struct Item {
+            std::u32string text;
+            float advance;
+            const GX::PackedPixmap *icon;
+        };
+        std::vector<Item> yields;
+        std::vector<Item> costs;
+    };
+    mutable UnitDescriptionLayout m_unitDescriptionLayout;
     enum class GameState {
         Intro,
         BeforeFirstUnit,
@@ -1,9 +1,10 @@
 #include "boostwidget.h"
 
 #include <QAbstractListModel>
-#include <QComboBox>
 #include <QDoubleSpinBox>
 #include <QFormLayout>
+#include <QLineEdit>
+#include <QListView>
 
 #include "techgraph.h"
 
@@ -30,6 +31,7 @@ public:
         connect(graph, &TechGraph::unitAboutToBeRemoved, this, [this, unitRow](const Unit *unit) {
             const auto row = unitRow(unit);
             beginRemoveRows({}, row, row);
+            m_checkedUnits.erase(std::remove(m_checkedUnits.begin(), m_checkedUnits.end(), unit), m_checkedUnits.end());
         });
         connect(graph, &TechGraph::unitRemoved, this, &UnitModel::endRemoveRows);
         connect(graph, &TechGraph::unitChanged, this, [this, unitRow](const Unit *unit) {
@@ -50,37 +52,91 @@ public:
         switch (role) {
         case Qt::DisplayRole:
             return m_graph->unit(index.row())->name;
+        case Qt::CheckStateRole: {
+            const auto *unit = m_graph->unit(index.row());
+            return std::find(m_checkedUnits.begin(), m_checkedUnits.end(), unit) != m_checkedUnits.end() ? Qt::Checked : Qt::Unchecked;
+        }
         case UnitRole:
             return QVariant::fromValue(m_graph->unit(index.row()));
         }
         return {};
     }
 
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override
+    {
+        if (!hasIndex(index.row(), index.column(), index.parent()) || role != Qt::CheckStateRole)
+            return false;
+        const auto *unit = m_graph->unit(index.row());
+        auto it = std::find(m_checkedUnits.begin(), m_checkedUnits.end(), unit);
+        if (static_cast<Qt::CheckState>(value.toInt()) == Qt::Checked) {
+            if (it == m_checkedUnits.end())
+                m_checkedUnits.push_back(unit);
+        } else if (it != m_checkedUnits.end()) {
+            m_checkedUnits.erase(it);
+        }
+        emit dataChanged(index, index, { Qt::CheckStateRole });
+        return true;
+    }
+
+    Qt::ItemFlags flags(const QModelIndex &index) const override
+    {
+        return QAbstractListModel::flags(index) | Qt::ItemIsUserCheckable;
+    }
+
+    // in the order they were checked
+    const std::vector<const Unit *> &checkedUnits() const
+    {
+        return m_checkedUnits;
+    }
+
+    void setCheckedUnits(const std::vector<const Unit *> &units)
+    {
+        m_checkedUnits = units;
+        if (const auto count = rowCount(); count > 0)
+            emit dataChanged(index(0, 0), index(count - 1, 0), { Qt::CheckStateRole });
+    }
+
 private:
     const TechGraph *m_graph;
+    std::vector<const Unit *> m_checkedUnits;
 };
 
 BoostWidget::BoostWidget(const TechGraph *graph, QWidget *parent)
     : QGroupBox(tr("Boost"), parent)
     , m_factor(new QDoubleSpinBox(this))
-    , m_target(new QComboBox(this))
+    , m_targets(new UnitModel(graph, this))
+    , m_categories(new QLineEdit(this))
 {
-    m_target->setModel(new UnitModel(graph, this));
+    auto *targetsView = new QListView(this);
+    targetsView->setModel(m_targets);
+
+    m_categories->setPlaceholderText(tr("Comma separated"));
 
     auto *layout = new QFormLayout(this);
 
     layout->addRow(tr("Factor"), m_factor);
-    layout->addRow(tr("Target"), m_target);
+    layout->addRow(tr("Targets"), targetsView);
+    layout->addRow(tr("Categories"), m_categories);
 
     connect(m_factor, qOverload<double>(&QDoubleSpinBox::valueChanged), this, &BoostWidget::valueChanged);
-    connect(m_target, qOverload<int>(&QComboBox::currentIndexChanged), this, &BoostWidget::valueChanged);
+    connect(m_targets, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex &, const QModelIndex &, const QVector<int> &roles) {
+        if (roles.contains(Qt::CheckStateRole))
+            emit valueChanged();
+    });
+    connect(m_categories, &QLineEdit::textChanged, this, &BoostWidget::valueChanged);
 }
 
 BoostWidget::~BoostWidget() = default;
 
 Boost BoostWidget::value() const
 {
-    return Boost { m_factor->value(), m_target->currentData(UnitModel::UnitRole).value<const Unit *>() };
+    QStringList categories;
+    for (const auto &part : m_categories->text().split(QLatin1Char(','))) {
+        const auto category = part.trimmed();
+        if (!category.isEmpty())
+            categories.append(category);
+    }
+    return Boost { m_factor->value(), m_targets->checkedUnits(), categories };
 }
 
 void BoostWidget::setValue(const Boost &value)
@@ -94,7 +150,11 @@ void BoostWidget::setValue(const Boost &value)
     }
 
     {
-        const QSignalBlocker sb(m_target);
-        m_target->setCurrentIndex(m_target->findData(QVariant::fromValue(value.target), UnitModel::UnitRole));
+        const QSignalBlocker sb(m_categories);
+        m_categories->setText(value.categories.join(QLatin1String(", ")));
     }
+
+    // not blocked, the view has to repaint; by now the rest of the value is
+    // up to date, so the valueChanged this emits is harmless
+    m_targets->setCheckedUnits(value.targets);
 }
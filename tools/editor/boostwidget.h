@@ -5,8 +5,10 @@
 struct Boost;
 class TechGraph;
 
+class UnitModel;
+
 class QDoubleSpinBox;
-class QComboBox;
+class QLineEdit;
 
 class BoostWidget : public QGroupBox
 {
@@ -23,5 +25,6 @@ signals:
 
 private:
     QDoubleSpinBox *m_factor;
-    QComboBox *m_target;
+    UnitModel *m_targets;
+    QLineEdit *m_categories;
 };
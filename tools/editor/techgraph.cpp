@@ -59,6 +59,11 @@ void TechGraph::setUnitDescription(const Unit *unit, const QString &description)
     mutateUnit(unit, &Unit::description, description);
 }
 
+void TechGraph::setUnitCategory(const Unit *unit, const QString &category)
+{
+    mutateUnit(unit, &Unit::category, category);
+}
+
 void TechGraph::setUnitPosition(const Unit *unit, const QPointF &position)
 {
     mutateUnit(unit, &Unit::position, position);
@@ -96,6 +101,8 @@ void TechGraph::removeUnit(const Unit *unit)
             continue;
         auto &dependencies = otherUnit->dependencies;
         dependencies.erase(std::remove(dependencies.begin(), dependencies.end(), unit), dependencies.end());
+        auto &targets = otherUnit->boost.targets;
+        targets.erase(std::remove(targets.begin(), targets.end(), unit), targets.end());
     }
     m_units.erase(it);
     emit unitRemoved();
@@ -228,6 +235,21 @@ QString targetKey()
     return QLatin1String("target");
 }
 
+QString targetsKey()
+{
+    return QLatin1String("targets");
+}
+
+QString categoryKey()
+{
+    return QLatin1String("category");
+}
+
+QString categoriesKey()
+{
+    return QLatin1String("categories");
+}
+
 template<typename T>
 QString enumToString(T value)
 {
@@ -291,10 +313,17 @@ QJsonObject TechGraph::save() const
         unitSettings[positionKey()] = positionArray;
         unitSettings[costKey()] = saveCost(unit->cost);
         unitSettings[yieldKey()] = saveCost(unit->yield);
-        unitSettings[boostKey()] = [&unitIndices, unitIndex, boost = unit->boost] {
+        if (!unit->category.isEmpty())
+            unitSettings[categoryKey()] = unit->category;
+        unitSettings[boostKey()] = [unitIndex, boost = unit->boost] {
             QJsonObject settings;
             settings[factorKey()] = boost.factor;
-            settings[targetKey()] = unitIndex(boost.target);
+            QJsonArray targetsArray;
+            for (auto *target : boost.targets)
+                targetsArray.append(unitIndex(target));
+            settings[targetsKey()] = targetsArray;
+            if (!boost.categories.isEmpty())
+                settings[categoriesKey()] = QJsonArray::fromStringList(boost.categories);
             return settings;
         }();
         QJsonArray dependenciesArray;
@@ -335,10 +364,23 @@ void TechGraph::load(const QJsonObject &settings)
         unit->position = QPointF(positionArray[0].toDouble(), positionArray[1].toDouble());
         unit->cost = loadCost(unitSettings[costKey()].toObject());
         unit->yield = loadCost(unitSettings[yieldKey()].toObject());
-        unit->boost = [this, unitFromIndex, settings = unitSettings[boostKey()].toObject()] {
-            const auto factor = settings[factorKey()].toDouble();
-            const auto targetIndex = settings[targetKey()].toInt();
-            return Boost { factor, unitFromIndex(targetIndex) };
+        unit->category = unitSettings[categoryKey()].toString();
+        unit->boost = [unitFromIndex, settings = unitSettings[boostKey()].toObject()] {
+            Boost boost;
+            boost.factor = settings[factorKey()].toDouble();
+            const auto addTarget = [&boost](const Unit *target) {
+                auto &targets = boost.targets;
+                if (target && std::find(targets.begin(), targets.end(), target) == targets.end())
+                    targets.push_back(target);
+            };
+            // "target" is the single target of older graph files, -1 if none
+            if (settings.contains(targetKey()))
+                addTarget(unitFromIndex(settings[targetKey()].toInt()));
+            for (const auto &value : settings[targetsKey()].toArray())
+                addTarget(unitFromIndex(value.toInt()));
+            for (const auto &value : settings[categoriesKey()].toArray())
+                boost.categories.append(value.toString());
+            return boost;
         }();
         const auto dependenciesArray = unitSettings[dependenciesKey()].toArray();
         std::transform(dependenciesArray.begin(), dependenciesArray.end(), std::back_inserter(unit->dependencies), [unitFromIndex](const QJsonValue &value) {
@@ -411,8 +453,8 @@ void TechGraph::autoAdjustCosts(const Cost &leafCost, const Cost &leafYield, dou
             expectedYield += MinUnitCount * unit->yield;
         } else {
             const auto &boost = unit->boost;
-            if (boost.target)
-                expectedYield += (boost.factor - 1.0) * MinUnitCount * boost.target->yield;
+            for (auto *target : boost.targets)
+                expectedYield += (boost.factor - 1.0) * MinUnitCount * target->yield;
         }
 
         qDebug() << unit->name << "cost=" << unit->cost << "yield=" << unit->yield;
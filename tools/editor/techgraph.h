@@ -2,8 +2,10 @@
 
 #include <QObject>
 #include <QPointF>
+#include <QStringList>
 
 #include <memory>
+#include <vector>
 
 class QJsonObject;
 
@@ -56,11 +58,12 @@ inline Cost operator*(double factor, const Cost &lhs)
 
 struct Boost {
     double factor = 1.0;
-    const Unit *target = nullptr;
+    std::vector<const Unit *> targets;
+    QStringList categories; // every unit in these is a target as well
 
     bool operator==(const Boost &other) const
     {
-        return qFuzzyCompare(factor, other.factor) && target == other.target;
+        return qFuzzyCompare(factor, other.factor) && targets == other.targets && categories == other.categories;
     }
 };
 
@@ -73,6 +76,7 @@ struct Unit {
 
     QString name;
     QString description;
+    QString category;
     Type type = Type::Generator;
     QPointF position;
     std::vector<const Unit *> dependencies;
@@ -98,6 +102,7 @@ public:
 
     void setUnitName(const Unit *unit, const QString &name);
     void setUnitDescription(const Unit *unit, const QString &name);
+    void setUnitCategory(const Unit *unit, const QString &category);
     void setUnitPosition(const Unit *unit, const QPointF &position);
     void setUnitCost(const Unit *unit, const Cost &cost);
     void setUnitYield(const Unit *unit, const Cost &cost);
@@ -15,6 +15,7 @@ UnitSettingsWidget::UnitSettingsWidget(TechGraph *graph, QWidget *parent)
     , m_graph(graph)
     , m_name(new QLineEdit(this))
     , m_description(new QLineEdit(this))
+    , m_category(new QLineEdit(this))
     , m_type(new QComboBox(this))
     , m_cost(new CostWidget(tr("Cost"), this))
     , m_yield(new CostWidget(tr("Yield"), this))
@@ -27,6 +28,7 @@ UnitSettingsWidget::UnitSettingsWidget(TechGraph *graph, QWidget *parent)
 
     formLayout->addRow(tr("Name"), m_name);
     formLayout->addRow(tr("Description"), m_description);
+    formLayout->addRow(tr("Category"), m_category);
     formLayout->addRow(tr("Type"), m_type);
 
     layout->addWidget(m_cost);
@@ -45,6 +47,10 @@ UnitSettingsWidget::UnitSettingsWidget(TechGraph *graph, QWidget *parent)
         if (m_unit)
             m_graph->setUnitDescription(m_unit, text);
     });
+    connect(m_category, &QLineEdit::textChanged, this, [this](const QString &text) {
+        if (m_unit)
+            m_graph->setUnitCategory(m_unit, text.trimmed());
+    });
     connect(m_cost, &CostWidget::valueChanged, this, [this]() {
         if (m_unit)
             m_graph->setUnitCost(m_unit, m_cost->value());
@@ -88,6 +94,7 @@ void UnitSettingsWidget::setUnit(const Unit *unit)
     if (unit) {
         m_name->setText(unit->name);
         m_description->setText(unit->description);
+        m_category->setText(unit->category);
         m_cost->setValue(unit->cost);
         m_yield->setValue(unit->yield);
         m_boost->setValue(unit->boost);
@@ -24,6 +24,7 @@ private:
     const Unit *m_unit = nullptr;
     QLineEdit *m_name;
     QLineEdit *m_description;
+    QLineEdit *m_category;
     QComboBox *m_type;
     CostWidget *m_cost;
     CostWidget *m_yield;
@@ -0,0 +1,59 @@
+#include <graphgenerator.h>
+#include <techgraph.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace std::string_literals;
+
+// Writes a generated tech graph in the format TechGraph::load reads, e.g.
+//
+//     graphgen --units 100000 --depth 40 --seed 7 -o graph100k.json
+//     simbench graph100k.json
+
+int main(int argc, char *argv[])
+{
+    GraphGeneratorSettings settings;
+    std::string outputPath = "techgraph-generated.json";
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] == "--units"s && i + 1 < argc)
+            settings.unitCount = std::strtoul(argv[++i], nullptr, 10);
+        else if (argv[i] == "--depth"s && i + 1 < argc)
+            settings.depth = std::strtoul(argv[++i], nullptr, 10);
+        else if (argv[i] == "--fan-in"s && i + 1 < argc)
+            settings.maxDependencies = std::strtoul(argv[++i], nullptr, 10);
+        else if (argv[i] == "--boosters"s && i + 1 < argc)
+            settings.boosterRatio = std::atof(argv[++i]);
+        else if (argv[i] == "--layout"s && i + 1 < argc)
+            settings.layout = argv[++i] == "radial"s ? GraphGeneratorSettings::Layout::Radial : GraphGeneratorSettings::Layout::Layered;
+        else if (argv[i] == "--seed"s && i + 1 < argc)
+            settings.seed = std::strtoul(argv[++i], nullptr, 10);
+        else if (argv[i] == "-o"s && i + 1 < argc)
+            outputPath = argv[++i];
+        else {
+            std::fprintf(stderr, "Usage: %s [--units N] [--depth N] [--fan-in N] [--boosters RATIO] [--layout layered|radial] [--seed N] [-o PATH]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (settings.unitCount == 0) {
+        std::fprintf(stderr, "Need at least one unit\n");
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto techGraph = generateTechGraph(settings);
+    const auto generated = std::chrono::steady_clock::now();
+    if (!techGraph.save(outputPath))
+        return 1;
+    const auto saved = std::chrono::steady_clock::now();
+
+    const auto milliseconds = [](auto duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+    fmt::print("{}: {} units, generated in {:.1f} ms, written in {:.1f} ms\n", outputPath, techGraph.units.size(),
+               milliseconds(generated - start), milliseconds(saved - generated));
+}
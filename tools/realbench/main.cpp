@@ -0,0 +1,212 @@
+#include <bot.h>
+#include <simulation.h>
+#include <techgraph.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+
+// Plays a day of the shipped tech graph tick by tick with the simulation
+// built for one Real type, to compare speed and accuracy between the types.
+// Built once per type (realbench_bigreal, realbench_double, ...); the long
+// double build, the widest type, writes the reference the others are checked
+// against (BigReal is double arithmetic below 1e77, so it can't be its own
+// reference):
+//
+//     realbench_longdouble --save-reference reference.txt
+//     realbench_float --reference reference.txt
+//
+// The realbench_report target does all of it. Only the state accumulators
+// (resources and their rate of change) have the Real type; unit costs,
+// yields and production are doubles in every build.
+
+namespace {
+
+constexpr auto TickRate = 60;
+constexpr auto Hour = 3600;
+constexpr auto Hours = 24;
+// four clicks a second of World's average harvest
+constexpr auto HarvestPerSecond = 4 * 6.5;
+
+const char *realName()
+{
+#if defined(REAL_FLOAT)
+    return "float";
+#elif defined(REAL_DOUBLE)
+    return "double";
+#elif defined(REAL_LONG_DOUBLE)
+    return "long double";
+#else
+    return "BigReal";
+#endif
+}
+
+struct Run {
+    std::vector<std::pair<long, std::size_t>> purchases; // tick, unit index
+    std::vector<std::array<long double, 4>> states; // extropy, energy, material, carbon at the end of every hour
+    double seconds = 0.0; // wall time
+    std::size_t refused = 0; // purchases of the followed run that weren't affordable
+};
+
+// Once a simulated second the player harvests by hand until something
+// produces energy and buys whatever is affordable, cheapest first. Or, to
+// compare the arithmetic along the same path, buys what the followed run
+// bought at the same ticks.
+Run play(const TechGraph &techGraph, const Run *followed = nullptr)
+{
+    std::vector<const Unit *> unitsBySourceIndex(techGraph.units.size());
+    for (const auto &unit : techGraph.units)
+        unitsBySourceIndex[unit->sourceIndex] = unit.get();
+
+    Run run;
+    Simulation simulation(&techGraph);
+    const CheapestFirst strategy;
+    std::size_t nextPurchase = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (long tick = 0; tick < static_cast<long>(Hours) * Hour * TickRate; ++tick) {
+        simulation.update(1.0 / TickRate);
+        if ((tick + 1) % TickRate == 0) {
+            if (simulation.stateDelta().energy == Real(0.0))
+                simulation.addEnergy(HarvestPerSecond);
+            if (followed) {
+                const auto &purchases = followed->purchases;
+                for (; nextPurchase < purchases.size() && purchases[nextPurchase].first == tick; ++nextPurchase) {
+                    const auto sourceIndex = purchases[nextPurchase].second;
+                    if (simulation.acquire(unitsBySourceIndex[sourceIndex]))
+                        run.purchases.emplace_back(tick, sourceIndex);
+                    else
+                        ++run.refused;
+                }
+            } else {
+                while (const auto *unit = strategy.choose(simulation)) {
+                    if (!simulation.acquire(unit))
+                        break;
+                    run.purchases.emplace_back(tick, unit->sourceIndex);
+                }
+            }
+        }
+        if ((tick + 1) % (Hour * TickRate) == 0) {
+            const auto state = simulation.state();
+            run.states.push_back({ static_cast<long double>(state.extropy), static_cast<long double>(state.energy), static_cast<long double>(state.material), static_cast<long double>(state.carbon) });
+        }
+    }
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return run;
+}
+
+bool saveRun(const Run &run, const std::string &path)
+{
+    std::ofstream file(path);
+    file << run.purchases.size() << '\n';
+    for (const auto &[tick, unit] : run.purchases)
+        file << tick << ' ' << unit << '\n';
+    file << run.states.size() << '\n' << std::hexfloat;
+    for (const auto &state : run.states)
+        file << state[0] << ' ' << state[1] << ' ' << state[2] << ' ' << state[3] << '\n';
+    return static_cast<bool>(file);
+}
+
+bool loadRun(Run &run, const std::string &path)
+{
+    std::ifstream file(path);
+    std::size_t count;
+    if (!(file >> count))
+        return false;
+    run.purchases.resize(count);
+    for (auto &[tick, unit] : run.purchases)
+        file >> tick >> unit;
+    if (!(file >> count))
+        return false;
+    run.states.resize(count);
+    for (auto &state : run.states) {
+        for (auto &value : state) {
+            std::string text;
+            file >> text;
+            value = std::strtold(text.c_str(), nullptr);
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+double nanosecondsPerTick(const Run &run)
+{
+    return 1e9 * run.seconds / (static_cast<double>(Hours) * Hour * TickRate);
+}
+
+void printReference(const Run &run)
+{
+    fmt::print("{:<12} {:>9.0f} ms {:>8.1f} ns/tick   reference, {} purchases\n", realName(), 1e3 * run.seconds, nanosecondsPerTick(run), run.purchases.size());
+}
+
+// run chose its own purchases, followed bought the reference's; the state
+// error is only meaningful along the same purchases
+void printComparison(const Run &run, const Run &followed, const Run &reference)
+{
+    const auto mismatch = std::mismatch(run.purchases.begin(), run.purchases.end(), reference.purchases.begin(), reference.purchases.end());
+    const auto matching = mismatch.first - run.purchases.begin();
+    long double maxError = 0.0;
+    for (std::size_t i = 0; i < std::min(followed.states.size(), reference.states.size()); ++i) {
+        for (std::size_t component = 0; component < 4; ++component) {
+            const auto expected = reference.states[i][component];
+            if (expected != 0.0)
+                maxError = std::max(maxError, std::abs(followed.states[i][component] - expected) / std::abs(expected));
+        }
+    }
+    const auto divergence = mismatch.first != run.purchases.end() ? fmt::format("diverge at {:.0f}s", mismatch.first->first / double(TickRate)) : "match"s;
+    fmt::print("{:<12} {:>9.0f} ms {:>8.1f} ns/tick   purchases: {}/{} {}   max state error: {:.3g} ({} refused)\n", realName(), 1e3 * run.seconds,
+               nanosecondsPerTick(run), matching, reference.purchases.size(), divergence, static_cast<double>(maxError), followed.refused);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string graphPath = "assets/data/techgraph.json";
+    std::string referencePath;
+    std::string saveReferencePath;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] == "--reference"s && i + 1 < argc)
+            referencePath = argv[++i];
+        else if (argv[i] == "--save-reference"s && i + 1 < argc)
+            saveReferencePath = argv[++i];
+        else if (argv[i][0] != '-')
+            graphPath = argv[i];
+        else {
+            std::fprintf(stderr, "Usage: %s [--reference PATH | --save-reference PATH] [graph]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    TechGraph techGraph;
+    if (!techGraph.load(graphPath)) {
+        std::fprintf(stderr, "Failed to load %s\n", graphPath.c_str());
+        return 1;
+    }
+
+    const auto run = play(techGraph);
+    if (!saveReferencePath.empty() && !saveRun(run, saveReferencePath)) {
+        std::fprintf(stderr, "Failed to write %s\n", saveReferencePath.c_str());
+        return 1;
+    }
+
+    if (referencePath.empty()) {
+        printReference(run);
+        return 0;
+    }
+    Run reference;
+    if (!loadRun(reference, referencePath)) {
+        std::fprintf(stderr, "Failed to read %s\n", referencePath.c_str());
+        return 1;
+    }
+    printComparison(run, play(techGraph, &reference), reference);
+}
@@ -0,0 +1,560 @@
+#include <autosaver.h>
+#include <fixedtimestep.h>
+#include <graphgenerator.h>
+#include <savegame.h>
+#include <simulation.h>
+#include <simulationthread.h>
+#include <statehistory.h>
+#include <techgraph.h>
+#include <unitstore.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <random>
+
+using namespace std::string_literals;
+
+namespace {
+
+template<typename F>
+void benchmark(const std::string &name, long iterations, F &&f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+        f(i);
+    const auto end = std::chrono::steady_clock::now();
+    const auto seconds = std::chrono::duration<double>(end - start).count();
+    fmt::print("{:<40} {:>12.1f} ns/iter {:>14.0f} iter/s\n", name, 1e9 * seconds / iterations, iterations / seconds);
+}
+
+// Free units with no dependencies; a quarter of them are boosters targeting
+// a random generator.
+TechGraph syntheticGraph(std::size_t unitCount)
+{
+    std::mt19937 generator(unitCount);
+    TechGraph techGraph;
+    techGraph.units.reserve(unitCount);
+    for (std::size_t i = 0; i < unitCount; ++i) {
+        auto unit = std::make_unique<Unit>();
+        unit->index = i;
+        if (i % 4 == 3) {
+            unit->type = Unit::Type::Booster;
+            const auto target = std::uniform_int_distribution<std::size_t>(0, i / 4)(generator) * 4;
+            unit->boost = Boost { 1.25, { techGraph.units[target].get() } };
+        } else {
+            unit->type = Unit::Type::Generator;
+            unit->yield = StateVector { 0, 1, 1, 0 };
+        }
+        techGraph.units.push_back(std::move(unit));
+    }
+    return techGraph;
+}
+
+// What World::updateStateDelta used to do on every purchase.
+StateVector quadraticStateDelta(const TechGraph &techGraph, const Simulation &simulation)
+{
+    StateVector delta;
+    for (const auto &unit : techGraph.units) {
+        const auto count = simulation.count(unit.get());
+        if (!count || unit->type != Unit::Type::Generator)
+            continue;
+        float boost = 1.0f;
+        for (const auto &other : techGraph.units) {
+            if (other->type == Unit::Type::Booster && simulation.count(other.get()) > 0 && std::count(other->boost.targets.begin(), other->boost.targets.end(), unit.get()))
+                boost *= other->boost.factor;
+        }
+        delta += count * boost * unit->yield;
+    }
+    return delta;
+}
+
+void benchmarkAcquire(std::size_t unitCount)
+{
+    const auto techGraph = syntheticGraph(unitCount);
+    const auto &units = techGraph.units;
+
+    // acquire units in a shuffled order so boosters land on generators that are already owned
+    std::vector<const Unit *> order;
+    for (const auto &unit : units)
+        order.push_back(unit.get());
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    Simulation simulation(&techGraph);
+    StateVector delta;
+    benchmark(fmt::format("acquire ({} units, incremental)", unitCount), unitCount, [&](long i) {
+        simulation.acquire(order[i]);
+        delta = simulation.stateDelta();
+    });
+
+    simulation.reset();
+    constexpr auto QuadraticAcquisitions = 20l;
+    for (std::size_t i = 0; i < unitCount - QuadraticAcquisitions; ++i)
+        simulation.acquire(order[i]);
+    benchmark(fmt::format("acquire ({} units, quadratic)", unitCount), QuadraticAcquisitions, [&](long i) {
+        simulation.acquire(order[unitCount - QuadraticAcquisitions + i]);
+        delta = quadraticStateDelta(techGraph, simulation);
+    });
+
+    const auto incrementalDelta = simulation.stateDelta();
+    fmt::print("  energy delta: {:g} (incremental) vs {:g} (quadratic)\n", static_cast<double>(incrementalDelta.energy), static_cast<double>(delta.energy));
+}
+
+// Boosters with several targets, a third of them boosting other boosters,
+// bought in a random order: the incremental refresh on every purchase
+// against recomputing all multipliers and the production.
+void benchmarkChainedBoosts(std::size_t unitCount)
+{
+    constexpr auto TargetCount = 4;
+    std::mt19937 generator(unitCount);
+    TechGraph techGraph;
+    auto &units = techGraph.units;
+    std::vector<const Unit *> generators, boosters;
+    for (std::size_t i = 0; i < unitCount; ++i) {
+        auto unit = std::make_unique<Unit>();
+        unit->index = i;
+        if (i % 4 == 3) {
+            unit->type = Unit::Type::Booster;
+            unit->boost.factor = 1.1;
+            // only earlier boosters, so there are no cycles
+            const auto &pool = !boosters.empty() && i % 3 == 0 ? boosters : generators;
+            for (auto j = 0; j < TargetCount; ++j) {
+                const auto target = pool[std::uniform_int_distribution<std::size_t>(0, pool.size() - 1)(generator)];
+                if (std::find(unit->boost.targets.begin(), unit->boost.targets.end(), target) == unit->boost.targets.end())
+                    unit->boost.targets.push_back(target);
+            }
+            boosters.push_back(unit.get());
+        } else {
+            unit->type = Unit::Type::Generator;
+            unit->yield = StateVector { 0, 1, 1, 0 };
+            generators.push_back(unit.get());
+        }
+        units.push_back(std::move(unit));
+    }
+    if (!techGraph.compile())
+        return;
+
+    std::vector<const Unit *> order;
+    for (const auto &unit : units)
+        order.push_back(unit.get());
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    Simulation simulation(&techGraph);
+    StateVector delta;
+    benchmark(fmt::format("acquire ({} units, chained boosts, incremental)", unitCount), unitCount, [&](long i) {
+        simulation.acquire(order[i]);
+        delta = simulation.stateDelta();
+    });
+    const auto incrementalDelta = simulation.stateDelta();
+
+    Simulation full(&techGraph);
+    constexpr auto FullAcquisitions = 100l;
+    auto counts = simulation.counts();
+    for (std::size_t i = unitCount - FullAcquisitions; i < unitCount; ++i)
+        counts[order[i]->index] = 0;
+    benchmark(fmt::format("acquire ({} units, chained boosts, full)", unitCount), FullAcquisitions, [&](long i) {
+        ++counts[order[unitCount - FullAcquisitions + i]->index];
+        full.restore(counts, {});
+        delta = full.stateDelta();
+    });
+    fmt::print("  energy delta: {:g} (incremental) vs {:g} (full)\n", static_cast<double>(incrementalDelta.energy), static_cast<double>(delta.energy));
+}
+
+// The per-unit loops over Unit records that UnitStore replaces.
+StateVector pointerProduction(const TechGraph &techGraph, const std::vector<int> &counts)
+{
+    StateVector production;
+    for (const auto &unit : techGraph.units) {
+        if (unit->type == Unit::Type::Generator)
+            production += counts[unit->index] * unit->yield;
+    }
+    return production;
+}
+
+void pointerTimesUntilAffordable(const TechGraph &techGraph, const std::vector<int> &counts, const StateVector &state, const StateVector &delta, std::vector<double> &times)
+{
+    for (const auto &unit : techGraph.units) {
+        const auto cost = unit->cost(counts[unit->index], techGraph.costGrowth);
+        double time = 0.0;
+        const auto timeUntil = [&time](Real cost, Real state, Real delta) {
+            if (cost <= state)
+                return;
+            time = delta > 0 ? std::max(time, static_cast<double>((cost - state) / delta)) : std::numeric_limits<double>::infinity();
+        };
+        timeUntil(cost.extropy, state.extropy, delta.extropy);
+        timeUntil(cost.energy, state.energy, delta.energy);
+        timeUntil(cost.material, state.material, delta.material);
+        times[unit->index] = time;
+    }
+}
+
+void benchmarkUnitStore(std::size_t unitCount)
+{
+    auto techGraph = syntheticGraph(unitCount);
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(1, 1e6);
+    for (auto &unit : techGraph.units)
+        unit->baseCost = StateVector { Real(distribution(generator)), Real(distribution(generator)), Real(distribution(generator)), 0 };
+
+    UnitStore store(&techGraph);
+    std::vector<int> counts(unitCount);
+    for (std::size_t i = 0; i < unitCount; ++i) {
+        counts[i] = i % 5;
+        store.setCount(i, counts[i]);
+    }
+    const std::vector<double> multipliers(unitCount, 1.0);
+    const auto state = StateVector { 1e5, 1e5, 1e5, 0 };
+    const auto delta = StateVector { 10, 20, 30, 0 };
+
+    StateVector production;
+    benchmark(fmt::format("production ({} units, pointers)", unitCount), 1000, [&](long) {
+        production = pointerProduction(techGraph, counts);
+    });
+    const auto pointerEnergy = static_cast<double>(production.energy);
+    benchmark(fmt::format("production ({} units, SoA)", unitCount), 1000, [&](long) {
+        production = store.production(multipliers);
+    });
+    fmt::print("  energy: {:g} (pointers) vs {:g} (SoA)\n", pointerEnergy, static_cast<double>(production.energy));
+
+    std::vector<double> pointerTimes(unitCount), times(unitCount);
+    benchmark(fmt::format("time until affordable ({} units, pointers)", unitCount), 1000, [&](long) {
+        pointerTimesUntilAffordable(techGraph, counts, state, delta, pointerTimes);
+    });
+    benchmark(fmt::format("time until affordable ({} units, SoA)", unitCount), 1000, [&](long) {
+        store.timesUntilAffordable(state, delta, times);
+    });
+    fmt::print("  mismatches: {}\n", std::inner_product(times.begin(), times.end(), pointerTimes.begin(), 0, std::plus<>(), std::not_equal_to<>()));
+}
+
+// Free generators, each depending on a few random earlier ones.
+TechGraph layeredGraph(std::size_t unitCount, std::size_t dependencyCount)
+{
+    std::mt19937 generator(unitCount);
+    TechGraph techGraph;
+    techGraph.units.reserve(unitCount);
+    for (std::size_t i = 0; i < unitCount; ++i) {
+        auto unit = std::make_unique<Unit>();
+        unit->index = i;
+        unit->yield = StateVector { 0, 1, 0, 0 };
+        for (std::size_t j = 0; i > 0 && j < dependencyCount; ++j)
+            unit->dependencies.push_back(techGraph.units[std::uniform_int_distribution<std::size_t>(0, i - 1)(generator)].get());
+        techGraph.units.push_back(std::move(unit));
+    }
+    return techGraph;
+}
+
+// What every hidden GraphItem used to do each frame.
+bool scanDependencies(const Simulation &simulation, const Unit *unit)
+{
+    return std::all_of(unit->dependencies.begin(), unit->dependencies.end(), [&simulation](const Unit *dependency) {
+        return simulation.count(dependency) > 0;
+    });
+}
+
+void benchmarkUnlockChecks(std::size_t unitCount)
+{
+    const auto techGraph = layeredGraph(unitCount, 4);
+    Simulation simulation(&techGraph);
+    for (std::size_t i = 0; i < unitCount / 2; ++i)
+        simulation.acquire(techGraph.units[i].get());
+
+    std::size_t scanned = 0, unlocked = 0;
+    benchmark(fmt::format("unlock checks ({} units, dependency scan)", unitCount), 1000, [&](long) {
+        scanned = std::count_if(techGraph.units.begin(), techGraph.units.end(), [&simulation](const auto &unit) {
+            return scanDependencies(simulation, unit.get());
+        });
+    });
+    benchmark(fmt::format("unlock checks ({} units, bitset)", unitCount), 1000, [&](long) {
+        unlocked = std::count_if(techGraph.units.begin(), techGraph.units.end(), [&simulation](const auto &unit) {
+            return simulation.isUnlocked(unit.get());
+        });
+    });
+    fmt::print("  unlocked: {} (dependency scan) vs {} (bitset)\n", scanned, unlocked);
+}
+
+void benchmarkBulkPurchase(const TechGraph &techGraph)
+{
+    constexpr auto Amount = 1000;
+    const auto *unit = techGraph.units.front().get();
+    Simulation simulation(&techGraph);
+    const auto funds = simulation.cost(unit, Amount).energy * 1.001;
+
+    int counts[3];
+    benchmark(fmt::format("buy {}, one at a time", Amount), 100, [&](long) {
+        simulation.reset();
+        simulation.addEnergy(funds);
+        for (int i = 0; i < Amount; ++i)
+            simulation.acquire(unit);
+        counts[0] = simulation.count(unit);
+    });
+    benchmark(fmt::format("buy {}, bulk", Amount), 100, [&](long) {
+        simulation.reset();
+        simulation.addEnergy(funds);
+        simulation.acquire(unit, Amount);
+        counts[1] = simulation.count(unit);
+    });
+    benchmark("buy max", 100, [&](long) {
+        simulation.reset();
+        simulation.addEnergy(funds);
+        simulation.acquire(unit, simulation.maxAcquirable(unit));
+        counts[2] = simulation.count(unit);
+    });
+    fmt::print("  count: {} (one at a time) vs {} (bulk) vs {} (max)\n", counts[0], counts[1], counts[2]);
+}
+
+// An hour of play at jittery frame times vs. a steady 60 fps, both driven
+// through FixedTimestep; the final states should match to the bit.
+void benchmarkFixedTimestep(const TechGraph &techGraph)
+{
+    constexpr auto Ticks = 60l * 60 * 60;
+    const auto run = [&techGraph](auto &&frameTime) {
+        Simulation simulation(&techGraph);
+        FixedTimestep timestep(60.0);
+        long tick = 0;
+        while (tick < Ticks) {
+            const auto ticks = timestep.advance(frameTime());
+            for (int i = 0; i < ticks && tick < Ticks; ++i, ++tick) {
+                simulation.update(timestep.tickInterval());
+                simulation.addEnergy(1);
+                for (const auto &unit : techGraph.units)
+                    simulation.acquire(unit.get());
+            }
+        }
+        return simulation.state();
+    };
+
+    StateVector steady, jittery;
+    benchmark("1h of ticks, 60 fps frames", 1, [&](long) {
+        steady = run([] { return std::chrono::nanoseconds(16'666'667); });
+    });
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<long> distribution(1'000'000, 100'000'000);
+    benchmark("1h of ticks, 10-1000 fps frames", 1, [&](long) {
+        jittery = run([&] { return std::chrono::nanoseconds(distribution(generator)); });
+    });
+    fmt::print("  energy: {:a} (steady) vs {:a} (jittery)\n", static_cast<double>(steady.energy), static_cast<double>(jittery.energy));
+}
+
+void benchmarkSaveGame(std::size_t unitCount)
+{
+    const auto techGraph = syntheticGraph(unitCount);
+    Simulation simulation(&techGraph);
+    for (std::size_t i = 0; i < unitCount; i += 3)
+        simulation.acquire(techGraph.units[i].get());
+    simulation.addEnergy(1e100);
+
+    const auto path = "simbench.sav"s;
+    SaveGame saveGame;
+    saveGame.counts = simulation.counts();
+    saveGame.state = simulation.state();
+    benchmark(fmt::format("save ({} units)", unitCount), 100, [&](long) {
+        saveGame.save(path);
+    });
+    SaveGame loaded;
+    benchmark(fmt::format("load ({} units)", unitCount), 100, [&](long) {
+        loaded.load(path);
+    });
+    Simulation restored(&techGraph);
+    restored.restore(loaded.counts, loaded.state);
+    fmt::print("  restored: {} (counts), {:g} vs {:g} (energy)\n", restored.counts() == simulation.counts() ? "match" : "differ",
+               static_cast<double>(restored.state().energy), static_cast<double>(simulation.state().energy));
+
+    // what the render loop pays for an autosave
+    {
+        Autosaver autosaver(path);
+        benchmark(fmt::format("autosave request ({} units)", unitCount), 100, [&](long) {
+            SaveGame snapshot;
+            snapshot.counts = simulation.counts();
+            snapshot.state = simulation.state();
+            autosaver.save(std::move(snapshot));
+        });
+    }
+    std::remove(path.c_str());
+}
+
+// What the game thread pays for a frame that buys something: running the
+// simulation inline vs. handing it to SimulationThread.
+void benchmarkSimulationThread(std::size_t unitCount)
+{
+    const auto techGraph = syntheticGraph(unitCount);
+    constexpr auto Frames = 2000l;
+    constexpr auto FrameTime = 1.0 / 60.0;
+
+    Simulation simulation(&techGraph);
+    FixedTimestep timestep(60.0);
+    benchmark(fmt::format("frame + purchase, inline ({} units)", unitCount), Frames, [&](long frame) {
+        for (int i = timestep.advance(FrameTime); i > 0; --i)
+            simulation.update(timestep.tickInterval());
+        simulation.addEnergy(1);
+        simulation.acquire(techGraph.units[frame % unitCount].get());
+    });
+
+    SimulationThread simulationThread(&techGraph, 60.0);
+    benchmark(fmt::format("frame + purchase, threaded ({} units)", unitCount), Frames, [&](long frame) {
+        simulationThread.update(FrameTime);
+        simulationThread.addEnergy(1);
+        simulationThread.acquire(techGraph.units[frame % unitCount].get(), false);
+    });
+    simulationThread.setSynchronous(true);
+    simulationThread.update(0.0);
+    const auto &snapshot = simulationThread.snapshot();
+    fmt::print("  counts: {}, energy: {:a} (inline) vs {:a} (threaded)\n", snapshot.counts == simulation.counts() ? "match" : "differ",
+               static_cast<double>(simulation.state().energy), static_cast<double>(snapshot.state.energy));
+}
+
+// Publishing a frame in which nothing was bought: the per-unit arrays of a
+// snapshot are only copied when the epochs moved, so this shouldn't grow
+// with the graph.
+void benchmarkIdleSnapshot(std::size_t unitCount)
+{
+    const auto techGraph = syntheticGraph(unitCount);
+    Simulation simulation(&techGraph);
+    std::array<SimulationSnapshot, 3> snapshots; // rotated like SimulationThread's triple buffer
+    benchmark(fmt::format("tick + snapshot, idle ({} units)", unitCount), 10'000, [&](long frame) {
+        simulation.update(1.0 / 60.0);
+        simulation.snapshot(snapshots[frame % snapshots.size()]);
+    });
+}
+
+// A frame's worth of history: one append per frame at 60 fps, so most
+// appends only accumulate and every 60th also completes a second.
+void benchmarkStateHistory()
+{
+    StateHistory history;
+    const StateVector delta { 1, 2, 3, 4 };
+    StateVector state;
+    benchmark("state history append", 1'000'000, [&](long) {
+        state += delta;
+        history.append(1.0 / 60.0, state, delta);
+    });
+    fmt::print("  samples: {} seconds, {} minutes, {} hours\n", history.size(StateHistory::Resolution::Second),
+               history.size(StateHistory::Resolution::Minute), history.size(StateHistory::Resolution::Hour));
+}
+
+// Compiling a generated graph whose units were shuffled, so every unit gets
+// renumbered.
+void benchmarkGraphCompile(std::size_t unitCount)
+{
+    GraphGeneratorSettings settings;
+    settings.unitCount = unitCount;
+    settings.depth = 40;
+    auto techGraph = generateTechGraph(settings);
+    std::shuffle(techGraph.units.begin(), techGraph.units.end(), std::mt19937(unitCount));
+    for (std::size_t i = 0; i < unitCount; ++i)
+        techGraph.units[i]->index = i;
+    bool valid = false;
+    benchmark(fmt::format("compile graph ({} units)", unitCount), 1, [&](long) {
+        valid = techGraph.compile();
+    });
+    fmt::print("  valid: {}, levels: {}\n", valid, techGraph.levelOffsets.size() - 1);
+}
+
+// Raw StateVector arithmetic over a batch of vectors: integrating from a
+// checkpoint like every tick does, and the affordability test and time
+// estimate done for every unit when rescheduling.
+void benchmarkStateVector()
+{
+    constexpr auto VectorCount = 1000;
+    std::mt19937 generator(VectorCount);
+    std::uniform_real_distribution<double> distribution(1, 1e6);
+    const auto randomVector = [&generator, &distribution] {
+        return StateVector { Real(distribution(generator)), Real(distribution(generator)), Real(distribution(generator)), Real(distribution(generator)) };
+    };
+    std::vector<StateVector> checkpoints(VectorCount), deltas(VectorCount), states(VectorCount);
+    for (std::size_t i = 0; i < VectorCount; ++i) {
+        checkpoints[i] = randomVector();
+        deltas[i] = randomVector();
+    }
+
+    benchmark(fmt::format("state vector integrate ({} vectors)", VectorCount), 10'000, [&](long i) {
+        const auto elapsed = Real(i * (1.0 / 60.0));
+        for (std::size_t j = 0; j < VectorCount; ++j)
+            states[j] = checkpoints[j] + deltas[j] * elapsed;
+    });
+
+    double total = 0;
+    benchmark(fmt::format("state vector schedule ({} vectors)", VectorCount), 10'000, [&](long i) {
+        const auto &state = states[i % VectorCount];
+        const auto &delta = deltas[i % VectorCount];
+        for (const auto &cost : checkpoints) {
+            if (cost.energy <= state.energy && cost.material <= state.material)
+                continue;
+            total += static_cast<double>(std::max((cost.energy - state.energy) / delta.energy, (cost.material - state.material) / delta.material));
+        }
+    });
+    fmt::print("  total time: {:g}\n", total);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::string graphPath = argc > 1 ? argv[1] : "assets/data/techgraph.json";
+
+    TechGraph techGraph;
+    if (!techGraph.load(graphPath)) {
+        std::fprintf(stderr, "Failed to load %s\n", graphPath.c_str());
+        return 1;
+    }
+    fmt::print("{}: {} units\n", graphPath, techGraph.units.size());
+
+    constexpr auto TickInterval = 1.0 / 60.0;
+    constexpr auto Ticks = 10'000'000l;
+
+    Simulation simulation(&techGraph);
+
+    benchmark("tick", Ticks, [&simulation](long) {
+        simulation.update(TickInterval);
+    });
+
+    // keep buying whatever we can afford, cheapest units first in graph order
+    simulation.reset();
+    benchmark("tick + acquire", Ticks / 10, [&simulation, &techGraph](long) {
+        simulation.addEnergy(10);
+        simulation.update(TickInterval);
+        for (const auto &unit : techGraph.units)
+            simulation.acquire(unit.get());
+    });
+    const auto state = simulation.state();
+    fmt::print("final energy: {:g}, material: {:g}, extropy: {:g}\n",
+               static_cast<double>(state.energy), static_cast<double>(state.material), static_cast<double>(state.extropy));
+
+    // offline progress: a day at 60 ticks per second vs. a single jump
+    constexpr auto Day = 24.0 * 60 * 60;
+    const auto start = simulation;
+    benchmark("24h, stepping frames", 1, [&simulation](long) {
+        for (long i = 0; i < static_cast<long>(Day / TickInterval); ++i)
+            simulation.update(TickInterval);
+    });
+    const auto stepped = simulation.state();
+    simulation = start;
+    benchmark("24h, fast forward", 1000, [&simulation, &start](long) {
+        simulation = start;
+        simulation.fastForward(Day);
+    });
+    fmt::print("  energy after 24h: {:g} (stepped) vs {:g} (fast forward)\n", static_cast<double>(stepped.energy), static_cast<double>(simulation.state().energy));
+
+    benchmarkBulkPurchase(techGraph);
+    benchmarkFixedTimestep(techGraph);
+
+    benchmarkStateVector();
+
+    for (const auto unitCount : { 10'000, 20'000 })
+        benchmarkAcquire(unitCount);
+    benchmarkChainedBoosts(20'000);
+
+    benchmarkUnitStore(20'000);
+    benchmarkUnlockChecks(20'000);
+    benchmarkSaveGame(20'000);
+    benchmarkSimulationThread(20'000);
+    benchmarkIdleSnapshot(20'000);
+    benchmarkIdleSnapshot(1'000'000);
+    benchmarkStateHistory();
+    for (const auto unitCount : { 100'000, 1'000'000 })
+        benchmarkGraphCompile(unitCount);
+}
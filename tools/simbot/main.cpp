@@ -0,0 +1,104 @@
+#include <bot.h>
+#include <techgraph.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <codecvt>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <locale>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+
+// Plays a tech graph with the bot to check how it plays out: how long it
+// takes to reach zettawatt capacity, and in which order the units get bought.
+
+namespace {
+
+constexpr auto Never = std::numeric_limits<double>::infinity();
+
+std::string toUtf8(const std::u32string &s)
+{
+    static std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> cv;
+    return cv.to_bytes(s);
+}
+
+std::string formatTime(double seconds)
+{
+    if (seconds == Never)
+        return "never"s;
+    const auto total = static_cast<long>(seconds);
+    return fmt::format("{}:{:02d}:{:02d}", total / 3600, static_cast<int>(total / 60 % 60), static_cast<int>(total % 60));
+}
+
+void printTimeline(const Playthrough &playthrough)
+{
+    for (const auto &purchase : playthrough.purchases) {
+        fmt::print("  {:>10} {:<40} #{:<5} {:>12.4g} Wh/s\n", formatTime(purchase.time), toUtf8(purchase.unit->name), purchase.count,
+                   static_cast<double>(purchase.energyProduction));
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string graphPath = "assets/data/techgraph.json";
+    std::string strategyName;
+    bool timeline = false;
+    double goal = Zettawatt;
+    double timeLimit = 10 * 365 * 24 * 60 * 60.0;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] == "--strategy"s && i + 1 < argc)
+            strategyName = argv[++i];
+        else if (argv[i] == "--timeline"s)
+            timeline = true;
+        else if (argv[i] == "--goal"s && i + 1 < argc)
+            goal = std::atof(argv[++i]);
+        else if (argv[i] == "--time-limit"s && i + 1 < argc)
+            timeLimit = std::atof(argv[++i]);
+        else
+            graphPath = argv[i];
+    }
+
+    TechGraph techGraph;
+    if (!techGraph.load(graphPath)) {
+        std::fprintf(stderr, "Failed to load %s\n", graphPath.c_str());
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<Strategy>> strategies;
+    strategies.push_back(std::make_unique<CheapestFirst>());
+    strategies.push_back(std::make_unique<BestYieldPerCost>());
+
+    bool allReachedGoal = true;
+    bool played = false;
+    for (const auto &strategy : strategies) {
+        if (!strategyName.empty() && strategy->name() != strategyName)
+            continue;
+        played = true;
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto playthrough = play(techGraph, *strategy, PlayerModel {}, 0, goal, timeLimit);
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        fmt::print("{:<10} {} {:>12} ({} purchases, {} harvesting), simulated in {:.3f} ms, {:.3g}x real time\n",
+                   strategy->name(), playthrough.reachedGoal ? "goal reached at" : "gave up at     ", formatTime(playthrough.time),
+                   playthrough.purchases.size(), formatTime(playthrough.clickTime), 1000.0 * seconds, playthrough.time / seconds);
+        if (timeline)
+            printTimeline(playthrough);
+        allReachedGoal = allReachedGoal && playthrough.reachedGoal;
+    }
+    if (!played) {
+        std::fprintf(stderr, "Unknown strategy %s\n", strategyName.c_str());
+        return 1;
+    }
+
+    // non-zero if the graph can't be finished, for use in scripts
+    return allReachedGoal ? 0 : 2;
+}
@@ -0,0 +1,198 @@
+#include "workstealing.h"
+
+#include <bot.h>
+#include <techgraph.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::string_literals;
+
+// Balance sweep: plays a tech graph many times with the bot for every
+// combination of the given cost growth factors, booster strengths and
+// strategies, and writes the distribution of the time it took to reach each
+// production milestone as CSV.
+//
+// The bot reacts to affordable units after a random delay and rolls its
+// harvest clicks, so runs of the same configuration differ. Run i uses seed i
+// in every configuration, so configurations are compared on the same luck.
+
+namespace {
+
+constexpr auto Never = std::numeric_limits<double>::infinity();
+
+std::vector<double> parseList(const std::string &list)
+{
+    std::vector<double> values;
+    std::istringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ','))
+        values.push_back(std::atof(value.c_str()));
+    return values;
+}
+
+// Copy of the graph with a different cost growth and with every booster's
+// effect scaled: a factor f becomes 1 + (f - 1) * boostScale.
+TechGraph variant(const TechGraph &techGraph, double costGrowth, double boostScale)
+{
+    TechGraph result;
+    result.costGrowth = costGrowth;
+    result.levelOffsets = techGraph.levelOffsets;
+    for (const auto &unit : techGraph.units)
+        result.units.push_back(std::make_unique<Unit>(*unit));
+    for (auto &unit : result.units) {
+        for (auto &dependency : unit->dependencies)
+            dependency = result.units[dependency->index].get();
+        for (auto &target : unit->boost.targets)
+            target = result.units[target->index].get();
+        if (unit->type == Unit::Type::Booster)
+            unit->boost.factor = 1.0 + (unit->boost.factor - 1.0) * boostScale;
+    }
+    return result;
+}
+
+struct Configuration {
+    double costGrowth;
+    double boostScale;
+    const TechGraph *techGraph;
+    const Strategy *strategy;
+};
+
+// Nearest rank; unreached milestones sort last as infinity.
+double percentile(const std::vector<double> &sorted, double p)
+{
+    const auto rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+std::string formatSeconds(double seconds)
+{
+    return seconds == Never ? ""s : fmt::format("{:.1f}", seconds);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string graphPath = "assets/data/techgraph.json";
+    std::string outputPath;
+    std::vector<double> costGrowths = { 1.15, CostGrowth, 1.25 };
+    std::vector<double> boostScales = { 1.0 };
+    std::string strategyName;
+    std::size_t runs = 100;
+    std::size_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    PlayerModel player;
+    player.randomHarvest = true;
+    player.reactionTime = 2.0;
+    double timeLimit = 10 * 365 * 24 * 60 * 60.0;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] == "--cost-growth"s && i + 1 < argc)
+            costGrowths = parseList(argv[++i]);
+        else if (argv[i] == "--boost-scale"s && i + 1 < argc)
+            boostScales = parseList(argv[++i]);
+        else if (argv[i] == "--strategy"s && i + 1 < argc)
+            strategyName = argv[++i];
+        else if (argv[i] == "--runs"s && i + 1 < argc)
+            runs = std::max(std::atoi(argv[++i]), 1);
+        else if (argv[i] == "--threads"s && i + 1 < argc)
+            threadCount = std::max(std::atoi(argv[++i]), 1);
+        else if (argv[i] == "--reaction-time"s && i + 1 < argc)
+            player.reactionTime = std::atof(argv[++i]);
+        else if (argv[i] == "--time-limit"s && i + 1 < argc)
+            timeLimit = std::atof(argv[++i]);
+        else if (argv[i] == "--output"s && i + 1 < argc)
+            outputPath = argv[++i];
+        else
+            graphPath = argv[i];
+    }
+    if (std::any_of(costGrowths.begin(), costGrowths.end(), [](double costGrowth) { return !(costGrowth > 1.0); })) {
+        std::fprintf(stderr, "Cost growth factors must be greater than 1\n");
+        return 1;
+    }
+
+    TechGraph techGraph;
+    if (!techGraph.load(graphPath)) {
+        std::fprintf(stderr, "Failed to load %s\n", graphPath.c_str());
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<Strategy>> strategies;
+    if (strategyName.empty() || strategyName == "cheapest")
+        strategies.push_back(std::make_unique<CheapestFirst>());
+    if (strategyName.empty() || strategyName == "yield")
+        strategies.push_back(std::make_unique<BestYieldPerCost>());
+    if (strategies.empty()) {
+        std::fprintf(stderr, "Unknown strategy %s\n", strategyName.c_str());
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<TechGraph>> graphs;
+    std::vector<Configuration> configurations;
+    for (const auto costGrowth : costGrowths) {
+        for (const auto boostScale : boostScales) {
+            graphs.push_back(std::make_unique<TechGraph>(variant(techGraph, costGrowth, boostScale)));
+            for (const auto &strategy : strategies)
+                configurations.push_back({ costGrowth, boostScale, graphs.back().get(), strategy.get() });
+        }
+    }
+
+    // one task per playthrough, results[configuration * runs + run]
+    const auto taskCount = configurations.size() * runs;
+    std::vector<std::array<double, Playthrough::MilestoneCount>> results(taskCount);
+    std::atomic<std::size_t> done = 0;
+    const auto start = std::chrono::steady_clock::now();
+    parallelFor(taskCount, threadCount, [&](std::size_t task) {
+        const auto &configuration = configurations[task / runs];
+        const auto run = static_cast<uint32_t>(task % runs);
+        results[task] = play(*configuration.techGraph, *configuration.strategy, player, run, Zettawatt, timeLimit).milestoneTimes;
+        const auto count = ++done;
+        if (count % 100 == 0 || count == taskCount)
+            std::fprintf(stderr, "\r%zu/%zu playthroughs", count, taskCount);
+    });
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "\n%zu playthroughs on %zu threads in %.2f s, %.0f per second\n", taskCount, threadCount, seconds, taskCount / seconds);
+
+    std::FILE *output = stdout;
+    if (!outputPath.empty()) {
+        output = std::fopen(outputPath.c_str(), "w");
+        if (!output) {
+            std::fprintf(stderr, "Failed to open %s for writing\n", outputPath.c_str());
+            return 1;
+        }
+    }
+
+    // times are in seconds, empty where fewer runs than the percentile reached the milestone
+    fmt::print(output, "cost_growth,boost_scale,strategy,milestone,runs,reached,min,p10,p50,p90,max,mean\n");
+    std::vector<double> times(runs);
+    for (std::size_t i = 0; i < configurations.size(); ++i) {
+        const auto &configuration = configurations[i];
+        for (int milestone = 0; milestone < Playthrough::MilestoneCount; ++milestone) {
+            for (std::size_t run = 0; run < runs; ++run)
+                times[run] = results[i * runs + run][milestone];
+            std::sort(times.begin(), times.end());
+            const auto reached = static_cast<std::size_t>(std::find(times.begin(), times.end(), Never) - times.begin());
+            const auto mean = reached == runs ? std::accumulate(times.begin(), times.end(), 0.0) / runs : Never;
+            fmt::print(output, "{},{},{},{:g},{},{},{},{},{},{},{},{}\n",
+                       configuration.costGrowth, configuration.boostScale, configuration.strategy->name(), Playthrough::milestone(milestone),
+                       runs, reached, formatSeconds(times.front()), formatSeconds(percentile(times, 0.1)), formatSeconds(percentile(times, 0.5)),
+                       formatSeconds(percentile(times, 0.9)), formatSeconds(times.back()), formatSeconds(mean));
+        }
+    }
+
+    if (output != stdout)
+        std::fclose(output);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Runs task(i) for every i in [0, count) on threadCount threads. Every thread
+// starts with an even share of the indices and works through it from the
+// back; once it runs dry it steals from the front of the others' queues, so a
+// few long runs don't leave the other cores idle at the end.
+template<typename Task>
+void parallelFor(std::size_t count, std::size_t threadCount, Task &&task)
+{
+    threadCount = std::max<std::size_t>(threadCount, 1);
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::size_t> indices;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (std::size_t i = 0; i < threadCount; ++i)
+        queues.push_back(std::make_unique<Queue>());
+    for (std::size_t i = 0; i < count; ++i)
+        queues[i % threadCount]->indices.push_back(i);
+
+    const auto popOwn = [&queues](std::size_t thread) -> std::optional<std::size_t> {
+        auto &queue = *queues[thread];
+        std::lock_guard lock(queue.mutex);
+        if (queue.indices.empty())
+            return {};
+        const auto index = queue.indices.back();
+        queue.indices.pop_back();
+        return index;
+    };
+    const auto steal = [&queues, threadCount](std::size_t thread) -> std::optional<std::size_t> {
+        for (std::size_t i = 1; i < threadCount; ++i) {
+            auto &queue = *queues[(thread + i) % threadCount];
+            std::lock_guard lock(queue.mutex);
+            if (!queue.indices.empty()) {
+                const auto index = queue.indices.front();
+                queue.indices.pop_front();
+                return index;
+            }
+        }
+        return {};
+    };
+
+    // nothing is ever pushed once the threads run, so an empty sweep over all
+    // queues means the work is done
+    const auto work = [&](std::size_t thread) {
+        while (true) {
+            auto index = popOwn(thread);
+            if (!index)
+                index = steal(thread);
+            if (!index)
+                break;
+            task(*index);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(work, i);
+    work(0);
+    for (auto &thread : threads)
+        thread.join();
+}
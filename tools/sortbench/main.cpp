@@ -0,0 +1,124 @@
+#include <radixsort.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Draw order sorting in SpriteBatcher::renderBatch: std::stable_sort over
+// pointers to the quads, which emission then chases again, against radix
+// sorting packed 64 bit keys and gathering the quads by the index in the
+// key. Needs no GL, the quads are filled like UIPainter fills them.
+
+namespace {
+
+struct Vertex {
+    float position[2];
+    float textureCoords[2];
+    float fgColor[4];
+    float bgColor[4];
+    float size[4];
+};
+
+struct Quad {
+    const void *texture;
+    int program;
+    std::array<Vertex, 4> verts;
+    int depth;
+};
+
+// same layout as SpriteBatcher::sortKey
+constexpr int SequenceBits = 20;
+constexpr int TextureBits = 12;
+constexpr int ProgramBits = 8;
+constexpr int DepthBits = 24;
+
+uint64_t sortKey(int depth, int program, std::size_t textureId, std::size_t sequence)
+{
+    const auto biasedDepth = static_cast<uint64_t>(depth + (1 << (DepthBits - 1)));
+    return biasedDepth << (ProgramBits + TextureBits + SequenceBits)
+            | static_cast<uint64_t>(program) << (TextureBits + SequenceBits)
+            | static_cast<uint64_t>(textureId) << SequenceBits
+            | static_cast<uint64_t>(sequence);
+}
+
+template<typename F>
+double benchmark(const std::string &name, std::size_t quadCount, long iterations, F &&f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+        f(i);
+    const auto end = std::chrono::steady_clock::now();
+    const auto seconds = std::chrono::duration<double>(end - start).count() / iterations;
+    fmt::print("{:<40} {:>12.1f} us/iter {:>8.2f} ns/quad\n", name, 1e6 * seconds, 1e9 * seconds / quadCount);
+    return seconds;
+}
+
+void benchmarkSort(std::size_t quadCount)
+{
+    // a graph screen: a few depths, all six programs, text from a couple of
+    // atlas pages, the rest untextured
+    std::mt19937 generator(quadCount);
+    const int textures[] = { 1, 2, 3 };
+    std::vector<Quad> quads(quadCount);
+    std::vector<const void *> textureIds { nullptr };
+    for (auto &quad : quads) {
+        quad.depth = std::uniform_int_distribution<int>(-1, 20)(generator) / 4;
+        quad.program = std::uniform_int_distribution<int>(0, 5)(generator);
+        quad.texture = quad.program == 0 ? &textures[std::uniform_int_distribution<int>(0, 2)(generator)] : nullptr;
+        for (auto &vertex : quad.verts)
+            vertex = { { 1, 2 }, { 0, 1 }, { 1, 1, 1, 1 }, { 0, 0, 0, 1 }, { 0.5f, 0, 0, 0 } };
+        if (std::find(textureIds.begin(), textureIds.end(), quad.texture) == textureIds.end())
+            textureIds.push_back(quad.texture);
+    }
+    std::vector<std::array<Vertex, 4>> buffer(quadCount);
+    const auto iterations = std::max<long>(1, 10'000'000 / quadCount);
+
+    std::vector<const Quad *> sortedQuads(quadCount);
+    const auto pointers = benchmark(fmt::format("stable_sort + emit ({} quads)", quadCount), quadCount, iterations, [&](long) {
+        std::transform(quads.begin(), quads.end(), sortedQuads.begin(), [](const Quad &quad) {
+            return &quad;
+        });
+        std::stable_sort(sortedQuads.begin(), sortedQuads.end(), [](const Quad *a, const Quad *b) {
+            return std::tie(a->depth, a->texture, a->program) < std::tie(b->depth, b->texture, b->program);
+        });
+        std::transform(sortedQuads.begin(), sortedQuads.end(), buffer.begin(), [](const Quad *quad) {
+            return quad->verts;
+        });
+    });
+
+    // as SpriteBatcher keeps them: upload records and keys in separate arrays
+    std::vector<std::array<Vertex, 4>> glQuads(quadCount);
+    std::vector<uint64_t> unsortedKeys(quadCount), keys(quadCount), scratch(quadCount);
+    for (std::size_t i = 0; i < quadCount; ++i) {
+        const auto &quad = quads[i];
+        const auto textureId = std::find(textureIds.begin(), textureIds.end(), quad.texture) - textureIds.begin();
+        unsortedKeys[i] = sortKey(quad.depth, quad.program, textureId, i);
+        glQuads[i] = quad.verts;
+    }
+    constexpr auto SequenceMask = (uint64_t(1) << SequenceBits) - 1;
+    const auto radix = benchmark(fmt::format("radix sort + emit ({} quads)", quadCount), quadCount, iterations, [&](long) {
+        keys = unsortedKeys;
+        GX::radixSort(keys.data(), scratch.data(), quadCount, SequenceBits);
+        std::transform(keys.begin(), keys.end(), buffer.begin(), [&glQuads](uint64_t key) {
+            return glQuads[key & SequenceMask];
+        });
+    });
+    // the keys come in sequence order, so sorting the bits above it has to
+    // order the whole keys
+    fmt::print("  {:.2f}x, keys {}\n", pointers / radix, std::is_sorted(keys.begin(), keys.end()) ? "sorted" : "NOT SORTED");
+}
+
+} // namespace
+
+int main()
+{
+    for (const auto quadCount : { 1'000, 10'000, 100'000 })
+        benchmarkSort(quadCount);
+}